@@ -0,0 +1,103 @@
+#pragma once
+
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/output/results.hpp>
+#include <simulator/population.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace simulator {
+  /**
+   * @brief Binary snapshot of a simulation at the end of a cycle
+   *
+   * Native endian file laid out as:
+   *
+   * - `Header`
+   * - the columns of the humans then of the mosquitos: states (u8),
+   *   positions (u32), counters (u32) and ids (u32, only when `sorted`)
+   * - the compartment counts of every replica (u64, 7 per replica)
+   * - `Results::Counts` of every cycle so far, of every replica
+   *
+   * The positions are in the input ids of the environment and are the
+   * positions of the cycle, before the movement of the next one, so a
+   * checkpoint resumes with any ordering and with or without the fused
+   * execution. The random numbers are keyed by the seed, the cycle and the
+   * agent ids, so they have no other state to save.
+   */
+  struct Checkpoint {
+    static constexpr auto magic =
+      std::array<char, 8> { 'S', 'I', 'M', 'C', 'K', 'P', '0', '1' };
+    static constexpr auto version = std::uint32_t { 1 };
+
+    struct Header {
+      std::array<char, 8> magic;
+      std::uint32_t version;
+      std::uint32_t sorted;
+      std::uint64_t iteration;
+      std::uint64_t seed;
+      std::uint64_t replicas;
+      // hash of the environment GeoJSON
+      std::uint64_t environment;
+      std::uint64_t humans;
+      std::uint64_t mosquitos;
+    };
+
+    Header header {};
+    Population<Human> humans { 0 };
+    Population<Mosquito> mosquitos { 0 };
+    std::vector<std::size_t> counts;
+    // the counts of every cycle so far, without agents
+    std::vector<std::vector<output::Results::Counts>> states;
+
+    /**
+     * @brief Write the checkpoint aside and rename it to `path`, so `path`
+     * is always a complete checkpoint
+     */
+    auto save(const std::filesystem::path& path) const -> void;
+
+    /**
+     * @brief Read a checkpoint, throws if it is not one
+     */
+    [[nodiscard]] static auto load(const std::filesystem::path& path)
+      -> Checkpoint;
+
+    /**
+     * @brief Read only the header of a checkpoint, e.g. the seed to parse
+     * the parameters with, throws if it is not one
+     */
+    [[nodiscard]] static auto load_header(const std::filesystem::path& path)
+      -> Header;
+  };
+
+  /**
+   * @brief Saves checkpoints on a worker thread, one at a time
+   *
+   * `write` waits for the previous checkpoint to be saved, so at most one
+   * checkpoint is in flight. A checkpoint failing to save is rethrown by the
+   * next `write` or `flush`, so a run never goes on with a stale checkpoint.
+   */
+  class CheckpointWriter {
+    std::filesystem::path path;
+    std::future<void> pending;
+
+  public:
+    explicit CheckpointWriter(std::filesystem::path path);
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    auto operator=(const CheckpointWriter&) -> CheckpointWriter& = delete;
+    ~CheckpointWriter();
+
+    auto write(std::unique_ptr<const Checkpoint> checkpoint) -> void;
+
+    /**
+     * @brief Wait until the last checkpoint is saved
+     */
+    auto flush() -> void;
+  };
+} // namespace simulator
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#ifdef SIMULATOR_MPI
+  #include <mpi.h>
+#endif
+
+namespace simulator::distributed {
+  /**
+   * @brief Collective operations between the ranks of a distributed
+   * simulation
+   *
+   * Every rank must call the same operations in the same order.
+   */
+  class Communicator {
+  public:
+    virtual ~Communicator() = default;
+
+    [[nodiscard]] virtual auto rank() const noexcept -> std::size_t = 0;
+    [[nodiscard]] virtual auto size() const noexcept -> std::size_t = 0;
+
+    /**
+     * @brief Send `outgoing[r]` to every rank `r`, returns the bytes received
+     * from every rank, concatenated in rank order
+     */
+    [[nodiscard]] virtual auto
+    exchange(const std::vector<std::vector<std::byte>>& outgoing)
+      -> std::vector<std::byte> = 0;
+
+    /**
+     * @brief Sum `values` over every rank, in place
+     */
+    virtual auto sum(std::span<std::uint64_t> values) -> void = 0;
+
+    /**
+     * @brief Wait for every rank
+     */
+    virtual auto barrier() -> void = 0;
+  };
+
+  /**
+   * @brief Local processes exchanging through an anonymous shared mapping, a
+   * stand-in for MPI on a single machine
+   *
+   * Each rank writes its outgoing bytes in its own segment of the mapping and
+   * reads the segments of the other ranks between two process-shared
+   * barriers.
+   */
+  class SharedMemoryCommunicator final : public Communicator {
+    struct Header;
+
+    Header* header;
+    std::size_t index;
+
+    SharedMemoryCommunicator(Header* header, std::size_t index) noexcept;
+
+    [[nodiscard]] auto segment(std::size_t rank) const noexcept
+      -> std::uint64_t*;
+    auto wait() const -> void;
+
+  public:
+    /**
+     * @brief Run `rank` in `ranks` processes, each sending at most
+     * `capacity` bytes per exchange
+     *
+     * The calling process is rank 0 and the other ranks are forked, so it
+     * must be called before the process starts any thread (a thread pool, or
+     * the parallel algorithms). Returns once every rank is done, throws if
+     * one of them failed: a rank throwing makes the other ranks throw in
+     * their next collective, and the ranks are killed if rank 0 dies.
+     */
+    static auto
+    run(std::size_t ranks, std::size_t capacity,
+        const std::function<void(std::shared_ptr<Communicator>)>& rank)
+      -> void;
+
+    [[nodiscard]] auto rank() const noexcept -> std::size_t override;
+    [[nodiscard]] auto size() const noexcept -> std::size_t override;
+    [[nodiscard]] auto
+    exchange(const std::vector<std::vector<std::byte>>& outgoing)
+      -> std::vector<std::byte> override;
+    auto sum(std::span<std::uint64_t> values) -> void override;
+    auto barrier() -> void override;
+  };
+
+#ifdef SIMULATOR_MPI
+  /**
+   * @brief Ranks of an MPI communicator, MPI must be initialized
+   */
+  class MpiCommunicator final : public Communicator {
+    MPI_Comm communicator;
+
+  public:
+    explicit MpiCommunicator(MPI_Comm communicator = MPI_COMM_WORLD) noexcept;
+
+    [[nodiscard]] auto rank() const noexcept -> std::size_t override;
+    [[nodiscard]] auto size() const noexcept -> std::size_t override;
+    [[nodiscard]] auto
+    exchange(const std::vector<std::vector<std::byte>>& outgoing)
+      -> std::vector<std::byte> override;
+    auto sum(std::span<std::uint64_t> values) -> void override;
+    auto barrier() -> void override;
+  };
+#endif
+} // namespace simulator::distributed
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <simulator/distributed/communicator.hpp>
+#include <simulator/environment.hpp>
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/parameters.hpp>
+#include <simulator/population.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace simulator::distributed {
+  /**
+   * @brief Contiguous ranges of nodes owned by the ranks
+   *
+   * Rank `r` owns the nodes `firsts[r]` up to `firsts[r + 1]`. A locality
+   * ordering of the environment (e.g. `rcm`) keeps the neighbours of a node
+   * mostly in the same range, so few agents cross a boundary.
+   */
+  struct Partition {
+    std::vector<std::size_t> firsts;
+
+    /**
+     * @brief Split the nodes in ranges of about the same number of nodes and
+     * edges
+     */
+    [[nodiscard]] static auto balanced(const Environment& environment,
+                                       std::size_t ranks) -> Partition;
+
+    /**
+     * @brief Rank owning a node
+     */
+    [[nodiscard]] auto owner(std::size_t node) const noexcept -> std::size_t;
+  };
+
+  /**
+   * @brief One rank of a simulation decomposed over a partition of the
+   * environment
+   *
+   * Each rank only holds the agents resident in its nodes and the edges of
+   * its nodes, whose neighbours in the other ranks are its halo. Agents
+   * moving to a node of another rank are sent to it at the end of the
+   * movement, and the compartment counts are summed over the ranks in the
+   * output, so every rank gets the states of the whole simulation.
+   *
+   * The random numbers are keyed by the agent ids as in `Simulation`, so the
+   * counts are the same as a single pairwise, unfused replica whatever the
+   * number of ranks. A rank runs its phases sequentially, ranks are meant to
+   * be one per core, and only the compartment counts are recorded.
+   */
+  class Simulation {
+    std::size_t iteration = 0;
+
+    std::shared_ptr<const Parameters> parameters;
+    std::shared_ptr<Communicator> communicator;
+    Partition partition;
+    std::uint64_t seed;
+    // nodes of the whole environment
+    std::size_t nodes;
+    // nodes owned by this rank
+    std::size_t first;
+    std::size_t last;
+    // edges of the owned nodes in CSR layout, `offsets[n - first]`, the
+    // neighbours are nodes of the whole environment
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> neighbours;
+    // input id and node of the owned nodes, by input id
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> inputs;
+
+    // the resident agents, with their ids
+    std::unique_ptr<Population<Human>> humans;
+    std::unique_ptr<Population<Mosquito>> mosquitos;
+    // resident agents per owned node, in CSR layout
+    std::vector<std::size_t> humans_offsets;
+    std::vector<std::uint32_t> humans_in_position;
+    std::vector<std::size_t> mosquitos_offsets;
+    std::vector<std::uint32_t> mosquitos_in_position;
+
+    // humans exposed and mosquitos infected in the cycle by this rank
+    std::uint64_t exposed = 0;
+    std::uint64_t infected = 0;
+
+    std::vector<State> states;
+
+    template <typename Agent>
+    auto migrate(Population<Agent>& population) -> void;
+    template <typename Agent>
+    auto group(const Population<Agent>& population,
+               std::vector<std::size_t>& offsets,
+               std::vector<std::uint32_t>& agents) const -> void;
+
+    [[nodiscard]] auto edges(std::size_t node) const noexcept
+      -> std::span<const std::uint32_t>;
+
+    auto insertion() -> void;
+    auto movement() -> void;
+    auto contact() -> void;
+    auto transition() -> void;
+    auto output() -> const State&;
+
+  public:
+    /**
+     * @brief Create the rank `communicator->rank()` of a simulation, every
+     * rank is given the same environment and parameters
+     *
+     * The environment is only read here, the rank keeps the edges of its
+     * nodes, so the environment can be released once every rank is created.
+     */
+    Simulation(std::shared_ptr<const Environment> environment,
+               std::shared_ptr<const Parameters> parameters,
+               std::shared_ptr<Communicator> communicator);
+
+    /**
+     * @brief Bytes a rank sends at most in an exchange, when every one of
+     * its agents leaves its nodes
+     */
+    [[nodiscard]] static auto capacity(const Parameters& parameters) noexcept
+      -> std::size_t;
+
+    /**
+     * @brief Run the simulation, collectively with the other ranks
+     */
+    auto run() -> void;
+
+    /**
+     * @brief Get the states of the simulation, the same on every rank
+     */
+    [[nodiscard]] auto get_states() const noexcept -> const std::vector<State>&;
+  };
+} // namespace simulator::distributed
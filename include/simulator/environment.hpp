@@ -1,19 +1,112 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
 #include <string_view>
-#include <vector>
 
 namespace simulator {
 
+  /**
+   * @brief Numbering of the nodes of an environment
+   *
+   * - `Input`: the GeoJSON ids
+   * - `ReverseCuthillMcKee`: breadth first from a low degree node and
+   *   reversed, so adjacent nodes get close indices
+   * - `Hilbert`: along a Hilbert curve over the coordinates of the nodes
+   */
+  enum struct Ordering : std::uint8_t { Input, ReverseCuthillMcKee, Hilbert };
+
+  /**
+   * @brief Parse an ordering, a.k.a. `input`, `rcm` or `hilbert`
+   */
+  [[nodiscard]] auto parse_ordering(std::string_view ordering) -> Ordering;
+
+  /**
+   * @brief Graph of the positions agents move between
+   *
+   * The adjacency is stored as CSR with 32-bit indices, the neighbours of node
+   * `n` are `neighbours[offsets[n]]` up to `neighbours[offsets[n + 1]]`. The
+   * arrays are views over `storage`, which either owns them (parsed from
+   * GeoJSON) or is a read only mapping of a compiled `environment.bin`, so
+   * copies of an environment share the same memory.
+   *
+   * A renumbered environment keeps the permutation between its nodes and the
+   * nodes of the input, so positions can be reported in the input ids.
+   */
   struct Environment {
-    using Point = std::pair<double, double>;
+    using Point = std::array<double, 2>;
 
-    std::vector<Point> points;
-    std::vector<std::vector<std::size_t>> edges;
+    std::span<const Point> points;
+    std::span<const std::uint32_t> offsets;
+    std::span<const std::uint32_t> neighbours;
     std::size_t size = 0UL;
+    // FNV-1a hash of the GeoJSON the environment was parsed from
+    std::uint64_t hash = 0;
+    std::shared_ptr<const void> storage;
+    // input node of each node and node of each input node, empty when the
+    // environment is in the input order
+    std::span<const std::uint32_t> inputs;
+    std::span<const std::uint32_t> nodes;
+
+    [[nodiscard]] auto edges(std::size_t node) const noexcept
+      -> std::span<const std::uint32_t> {
+      return neighbours.subspan(offsets[node],
+                                offsets[node + 1] - offsets[node]);
+    }
+
+    /**
+     * @brief Input id of a node
+     */
+    [[nodiscard]] auto input(std::size_t node) const noexcept
+      -> std::uint32_t {
+      return inputs.empty() ? static_cast<std::uint32_t>(node) : inputs[node];
+    }
+
+    /**
+     * @brief Node of an input id
+     */
+    [[nodiscard]] auto node(std::size_t input) const noexcept
+      -> std::uint32_t {
+      return nodes.empty() ? static_cast<std::uint32_t>(input) : nodes[input];
+    }
 
     static auto from_geojson(const std::string_view) noexcept -> Environment;
+
+    /**
+     * @brief Map a compiled environment, throws if it is not one
+     */
+    static auto from_binary(const std::filesystem::path& path) -> Environment;
+
+    /**
+     * @brief Compile the environment, recording the size and modification
+     * time of its GeoJSON `source` to detect stale caches
+     */
+    auto to_binary(const std::filesystem::path& path,
+                   const std::filesystem::path& source) const -> void;
+
+    /**
+     * @brief Load the `environment.json` of a simulation directory
+     *
+     * The compiled `environment.bin` next to it is mapped when it is up to
+     * date, otherwise the GeoJSON is parsed and the cache (re)written. The
+     * cache is up to date when the size and the modification time of the
+     * GeoJSON match, or when only the size matches, or the times are too
+     * close to tell, and so does the hash of its contents.
+     */
+    static auto load(const std::filesystem::path& directory) -> Environment;
+
+    /**
+     * @brief Renumber the nodes, so neighbouring nodes are close in memory
+     *
+     * The neighbours of each node keep their order, so a simulation drawing
+     * its positions through `node` gives the same results in every ordering,
+     * up to the numbering of the positions.
+     */
+    [[nodiscard]] auto reorder(Ordering ordering) const -> Environment;
   };
 
 } // namespace simulator
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace simulator {
+  /**
+   * @brief Where a phase of the simulation runs
+   *
+   * - `Sync`: `std::execution::par_unseq` algorithms
+   * - `Cpu`: bulk senders on the simulation `exec::static_thread_pool`
+   * - `Gpu`: bulk senders on the simulation `nvexec::stream_context`, or on
+   *   the thread pool in the host only build (`SIMULATOR_HOST_ONLY`)
+   */
+  enum struct Placement : std::uint8_t { Sync, Cpu, Gpu };
+
+  /**
+   * @brief Parse a placement, a.k.a. `sync`, `cpu` or `gpu`
+   */
+  [[nodiscard]] auto parse_placement(std::string_view placement) -> Placement;
+
+  /**
+   * @brief Placement of each phase of a simulation, chosen at runtime
+   */
+  struct Execution {
+    Placement insertion = Placement::Gpu;
+    Placement movement = Placement::Gpu;
+    Placement contact = Placement::Gpu;
+    Placement transition = Placement::Gpu;
+
+    /**
+     * @brief Fuse the transition, the compartment counting and the movement
+     * of the next cycle in a single pass per agent, placed as the transition
+     *
+     * The results are the same as unfused, with contact as the only barrier
+     * between the passes over the agents.
+     */
+    bool fused = false;
+
+    /**
+     * @brief Replace the pairwise contact with the aggregated infection
+     * pressure of each cell
+     *
+     * Every susceptible of a cell with `k` infectious agents gets a single
+     * draw against `1 - (1 - p)^k`, so a cell costs O(humans + mosquitos)
+     * instead of O(humans * mosquitos + mosquitos^2). The infectious agents
+     * are counted before the cell is updated, which is statistically
+     * equivalent to the pairwise contact except for the agents infected and
+     * infecting within the same cycle.
+     */
+    bool aggregated = false;
+
+    /**
+     * @brief Sort the agents by cell every `sort_interval` cycles, never when
+     * 0
+     *
+     * The agents of a cell are then next to each other, so the movement and
+     * the contact stream through the populations. The draws are keyed by the
+     * agent ids and the agents are recorded by id, so the results are the
+     * same with every interval.
+     */
+    std::size_t sort_interval = 0;
+
+    /**
+     * @brief Run the `Cpu` phases on one pool per NUMA node, pinned to the
+     * cpus of its node
+     *
+     * Every bulk is split in contiguous shares, one per node, and the agent
+     * and cell arrays are split the same way and first touched by the pool of
+     * their node, so each node mostly streams through its own memory. The
+     * simulations sharing an external pool (the Monte Carlo replicas) keep
+     * it. Ignored outside the host only build, whose columns are in managed
+     * memory.
+     */
+    bool numa = false;
+
+    /**
+     * @brief Place every phase on `placement`, except the phases given their
+     * own placement, as the CLIs `--execution` and `--<phase>` flags
+     */
+    [[nodiscard]] static auto from_strings(
+      std::string_view placement,
+      std::optional<std::string_view> insertion = std::nullopt,
+      std::optional<std::string_view> movement = std::nullopt,
+      std::optional<std::string_view> contact = std::nullopt,
+      std::optional<std::string_view> transition = std::nullopt) -> Execution;
+  };
+} // namespace simulator
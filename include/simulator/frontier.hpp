@@ -0,0 +1,108 @@
+#pragma once
+
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/population.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <span>
+#include <vector>
+
+namespace simulator {
+  /**
+   * @brief Cells where a transmission is possible, a.k.a. the cells with an
+   * infectious agent and a susceptible agent it can infect
+   *
+   * The susceptible and infectious agents of each cell are counted
+   * incrementally by the phases that move agents or change their states, so
+   * the frontier is compacted with a scan over the counters instead of a
+   * pass over the agents.
+   */
+  struct Frontier {
+    /**
+     * @brief Counter of a cell an agent state is counted in
+     */
+    enum Kind : std::uint8_t {
+      SusceptibleHumans,
+      InfectiousHumans,
+      SusceptibleMosquitos,
+      InfectiousMosquitos,
+      // not counted
+      None,
+    };
+
+    std::vector<std::array<std::uint32_t, None>> counts;
+    std::vector<std::size_t> cells;
+    std::vector<std::size_t> active;
+    std::size_t size = 0;
+
+    explicit Frontier(std::size_t cells);
+
+    [[nodiscard]] static constexpr auto kind(Human::State state) noexcept
+      -> Kind {
+      return state == Human::State::Susceptible ? SusceptibleHumans
+        : state == Human::State::Infected       ? InfectiousHumans
+                                                : None;
+    }
+
+    [[nodiscard]] static constexpr auto kind(Mosquito::State state) noexcept
+      -> Kind {
+      return state == Mosquito::State::Susceptible ? SusceptibleMosquitos
+        : state == Mosquito::State::Infected       ? InfectiousMosquitos
+                                                   : None;
+    }
+
+    /**
+     * @brief Record that `count` agents of `kind` entered a cell, safe to
+     * call concurrently
+     */
+    auto add(Kind kind, std::size_t cell, std::uint32_t count = 1) noexcept
+      -> void {
+      if (kind != None) {
+        std::atomic_ref(counts[cell][kind])
+          .fetch_add(count, std::memory_order_relaxed);
+      }
+    }
+
+    /**
+     * @brief Record that `count` agents of `kind` left a cell, safe to call
+     * concurrently
+     */
+    auto remove(Kind kind, std::size_t cell, std::uint32_t count = 1) noexcept
+      -> void {
+      if (kind != None) {
+        std::atomic_ref(counts[cell][kind])
+          .fetch_sub(count, std::memory_order_relaxed);
+      }
+    }
+
+    /**
+     * @brief Count the agents of a population from scratch, agent `i` being
+     * in the cell `cell(i)`
+     */
+    template <typename Agent, typename Cell>
+    auto reset(const Population<Agent>& population, Cell cell) noexcept
+      -> void {
+      const auto& states = population.states;
+      std::for_each(std::execution::par, std::begin(states), std::end(states),
+                    [this, &states, cell](const auto& state) {
+                      add(kind(state), cell(&state - states.data()));
+                    });
+    }
+
+    /**
+     * @brief Clear the counts of every cell, before counting the populations
+     */
+    auto clear() noexcept -> void;
+
+    /**
+     * @brief Compact the active cells, in ascending order
+     */
+    auto update() noexcept -> std::span<const std::size_t>;
+  };
+} // namespace simulator
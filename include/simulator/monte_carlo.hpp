@@ -1,15 +1,91 @@
 #pragma once
 
 #include <simulator/environment.hpp>
+#include <simulator/execution.hpp>
+#include <simulator/output/sink.hpp>
 #include <simulator/parameters.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <exec/static_thread_pool.hpp>
 
 namespace simulator {
+  /**
+   * @brief Run `Parameters::runs` replicas of a simulation concurrently
+   *
+   * The replicas share the read only environment, and each one re-samples the
+   * parameter ranges with its own seed derived from the master seed. Replica 0
+   * uses the master seed itself, so it reproduces a plain `Simulation`.
+   */
   class MonteCarlo {
-    const Environment& environment;
-    const Parameters& parameters;
+  public:
+    /**
+     * @brief Make the sink of a replica from its index and parameters
+     */
+    using SinkFactory = std::function<std::shared_ptr<output::Sink>(
+      std::size_t, const Parameters&)>;
+
+    /**
+     * @brief Take the states of a replica from its index and parameters, as
+     * soon as it is done
+     *
+     * Called from the thread that ran the replica, so up to `jobs` replicas
+     * are handed at once. The states are released when it returns.
+     */
+    using ReplicaHandler = std::function<void(
+      std::size_t, const Parameters&, const std::vector<State>&)>;
+
+  private:
+    std::shared_ptr<const Environment> environment;
+    std::string parameters;
+    std::uint64_t seed;
+    std::size_t runs;
+    std::size_t jobs;
+    SinkFactory make_sink;
+    Execution execution;
+    std::shared_ptr<exec::static_thread_pool> pool;
 
   public:
-    MonteCarlo(const Environment& environment, const Parameters& parameters);
-    auto run() const -> void;
+    /**
+     * @brief Create a Monte Carlo run from the parameters json
+     *
+     * Up to `jobs` replicas run at once, sharing a pool of `threads`
+     * threads. When `make_sink` is null every agent is recorded, as
+     * in `Simulation`. Every replica runs its phases on `execution`.
+     */
+    MonteCarlo(std::shared_ptr<const Environment> environment,
+               std::string_view parameters,
+               std::optional<std::uint64_t> seed = std::nullopt,
+               std::size_t jobs = std::thread::hardware_concurrency(),
+               SinkFactory make_sink = nullptr, Execution execution = {},
+               std::size_t threads = std::thread::hardware_concurrency());
+    /**
+     * @brief Create a Monte Carlo run whose replicas run their cpu phases on
+     * an externally owned pool
+     */
+    MonteCarlo(std::shared_ptr<const Environment> environment,
+               std::string_view parameters, std::optional<std::uint64_t> seed,
+               std::size_t jobs, SinkFactory make_sink, Execution execution,
+               std::shared_ptr<exec::static_thread_pool> pool);
+
+    [[nodiscard]] static auto replica_seed(std::uint64_t seed,
+                                           std::size_t replica) noexcept
+      -> std::uint64_t;
+
+    /**
+     * @brief Run every replica, handing each one to `done` once it is over
+     *
+     * Only the running replicas are held, whatever the number of runs.
+     */
+    auto run(const ReplicaHandler& done) const -> void;
   };
 } // namespace simulator
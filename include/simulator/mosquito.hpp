@@ -7,7 +7,7 @@
 
 namespace simulator {
   struct Mosquito {
-    enum struct State {
+    enum struct State : char {
       Susceptible = 's',
       Infected = 'i',
       Recovered = 'r'
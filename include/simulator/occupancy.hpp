@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace simulator {
+  /**
+   * @brief Compact index of the agents in each cell of the environment
+   *
+   * The agents are grouped by cell in CSR layout: the ids of the agents in
+   * cell `c` are `agents[offsets[c]]` up to `agents[offsets[c + 1]]`, so the
+   * memory used is O(cells + agents) instead of O(cells * agents).
+   *
+   * The number of agents per cell is maintained incrementally through
+   * `depart`/`arrive`, so the index can be rebuilt with a parallel counting
+   * sort without recounting the whole population.
+   */
+  struct Occupancy {
+    std::vector<std::size_t> counts;
+    std::vector<std::size_t> offsets;
+    std::vector<std::size_t> agents;
+    std::vector<std::size_t> cursors;
+    std::vector<std::size_t> ids;
+
+    Occupancy(std::size_t cells, std::size_t agents);
+
+    /**
+     * @brief Record that an agent left a cell, safe to call concurrently
+     */
+    auto depart(std::size_t cell) noexcept -> void {
+      std::atomic_ref(counts[cell]).fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record that an agent entered a cell, safe to call concurrently
+     */
+    auto arrive(std::size_t cell) noexcept -> void {
+      std::atomic_ref(counts[cell]).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Count the agents per cell from scratch and rebuild the index
+     */
+    template <typename Position>
+    auto reset(Position position) noexcept -> void {
+      std::fill(std::execution::par_unseq, std::begin(counts), std::end(counts),
+                0UL);
+      std::for_each(std::execution::par, std::begin(ids), std::end(ids),
+                    [this, position](auto id) { arrive(position(id)); });
+      rebuild(position);
+    }
+
+    /**
+     * @brief Rebuild the index from the maintained counts
+     *
+     * Parallel counting sort keyed by `position(id)`. Agents are scattered
+     * in arbitrary order and each cell is then sorted, so agents in a cell
+     * are always in ascending id order.
+     */
+    template <typename Position>
+    auto rebuild(Position position) noexcept -> void {
+      std::exclusive_scan(std::execution::par_unseq, std::begin(counts),
+                          std::end(counts), std::begin(offsets), 0UL);
+      offsets.back() = agents.size();
+      std::copy(std::execution::par_unseq, std::begin(offsets),
+                std::end(offsets) - 1, std::begin(cursors));
+
+      std::for_each(std::execution::par, std::begin(ids), std::end(ids),
+                    [this, position](auto id) {
+                      const auto slot =
+                        std::atomic_ref(cursors[position(id)])
+                          .fetch_add(1, std::memory_order_relaxed);
+                      agents[slot] = id;
+                    });
+
+      std::for_each(std::execution::par, std::begin(offsets),
+                    std::end(offsets) - 1, [this](const auto& offset) {
+                      const auto cell = &offset - offsets.data();
+                      std::sort(std::begin(agents) + offset,
+                                std::begin(agents) + offsets[cell + 1]);
+                    });
+    }
+
+    /**
+     * @brief Get the ids of the agents in a cell
+     */
+    [[nodiscard]] auto in(std::size_t cell) const noexcept
+      -> std::span<const std::size_t>;
+  };
+} // namespace simulator
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/population.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace simulator::output {
+  /**
+   * @brief Delta encoded history of a population
+   *
+   * A full keyframe is stored every `interval` cycles, and in between only the
+   * agents flagged in `Population::changes` are stored as change records.
+   */
+  template <typename Agent>
+  class Trajectory {
+    using State = typename Agent::State;
+
+    struct Keyframe {
+      std::size_t cycle;
+      std::vector<State> states;
+      std::vector<std::uint32_t> positions;
+    };
+
+    struct Change {
+      std::uint32_t id;
+      std::uint32_t position;
+      State state;
+    };
+
+    std::size_t interval;
+    std::uint8_t mask;
+    std::vector<Keyframe> keyframes;
+    std::vector<Change> changes;
+    // changes of cycle `c` are `changes[offsets[c - 1]]` up to
+    // `changes[offsets[c]]`
+    std::vector<std::size_t> offsets { 0 };
+
+  public:
+    Trajectory(std::size_t interval, bool positions)
+      : interval(interval),
+        mask(Population<Agent>::StateChanged |
+             (positions ? Population<Agent>::PositionChanged : 0)) {}
+
+    auto record(std::size_t cycle, const Population<Agent>& population)
+      -> void {
+      if ((cycle - 1) % interval == 0) {
+        keyframes.push_back(
+          { cycle, population.states, population.positions });
+      } else {
+        for (std::size_t id = 0; id < population.size(); id++) {
+          if ((population.changes[id] & mask) != 0) {
+            changes.push_back({ static_cast<std::uint32_t>(id),
+                                population.positions[id],
+                                population.states[id] });
+          }
+        }
+      }
+      offsets.push_back(changes.size());
+    }
+
+    /**
+     * @brief Reconstruct the population at a recorded cycle (1-based)
+     *
+     * Counters are not recorded and are always zero.
+     */
+    [[nodiscard]] auto at(std::size_t cycle) const -> std::vector<Agent> {
+      const auto& keyframe = keyframes[(cycle - 1) / interval];
+
+      auto states = keyframe.states;
+      auto positions = keyframe.positions;
+      for (auto i = offsets[keyframe.cycle]; i < offsets[cycle]; i++) {
+        const auto& change = changes[i];
+        states[change.id] = change.state;
+        positions[change.id] = change.position;
+      }
+
+      std::vector<Agent> agents;
+      agents.reserve(states.size());
+      for (std::size_t id = 0; id < states.size(); id++) {
+        agents.push_back(Agent { states[id], id, positions[id], 0 });
+      }
+      return agents;
+    }
+
+    [[nodiscard]] auto cycles() const noexcept -> std::size_t {
+      return offsets.size() - 1;
+    }
+
+    /**
+     * @brief The keyframes and the change records as stored, the changes of
+     * cycle `c` are the entries `offsets[c - 1]` up to `offsets[c]` of the
+     * change columns
+     */
+    [[nodiscard]] auto to_json() const -> nlohmann::json {
+      auto json = nlohmann::json::object();
+      json["interval"] = interval;
+
+      auto keyframes = nlohmann::json::array();
+      for (const auto& keyframe : this->keyframes) {
+        keyframes.push_back(nlohmann::json {
+          { "cycle", keyframe.cycle },
+          { "states", keyframe.states },
+          { "positions", keyframe.positions },
+        });
+      }
+      json["keyframes"] = keyframes;
+
+      auto ids = std::vector<std::uint32_t>();
+      auto positions = std::vector<std::uint32_t>();
+      auto states = std::vector<State>();
+      ids.reserve(changes.size());
+      positions.reserve(changes.size());
+      states.reserve(changes.size());
+      for (const auto& change : changes) {
+        ids.push_back(change.id);
+        positions.push_back(change.position);
+        states.push_back(change.state);
+      }
+      json["changes"] = nlohmann::json {
+        { "offsets", offsets },
+        { "ids", ids },
+        { "positions", positions },
+        { "states", states },
+      };
+      return json;
+    }
+
+    /**
+     * @brief Number of stored keyframe entries and change records
+     */
+    [[nodiscard]] auto records() const noexcept -> std::size_t {
+      auto records = changes.size();
+      for (const auto& keyframe : keyframes) {
+        records += keyframe.states.size();
+      }
+      return records;
+    }
+  };
+
+  /**
+   * @brief Sink that records the agent level history of both populations
+   *
+   * When `positions` is false only state changes produce records, and the
+   * positions between keyframes are the ones of the last record of the agent.
+   */
+  class HistorySink final : public Sink {
+    Trajectory<Human> humans;
+    Trajectory<Mosquito> mosquitos;
+
+  public:
+    explicit HistorySink(std::size_t interval = 32, bool positions = true);
+
+    auto record(State& state, const Population<Human>& humans,
+                const Population<Mosquito>& mosquitos) -> void override;
+
+    [[nodiscard]] auto humans_at(std::size_t cycle) const
+      -> std::vector<Human>;
+    [[nodiscard]] auto mosquitos_at(std::size_t cycle) const
+      -> std::vector<Mosquito>;
+    [[nodiscard]] auto cycles() const noexcept -> std::size_t;
+
+    /**
+     * @brief The trajectories of both populations, written by the CLIs to
+     * `history.json` in the `history` output mode
+     */
+    [[nodiscard]] auto to_json() const -> nlohmann::json;
+  };
+} // namespace simulator::output
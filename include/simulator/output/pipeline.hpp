@@ -0,0 +1,66 @@
+#pragma once
+
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/population.hpp>
+#include <simulator/state.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simulator::output {
+  /**
+   * @brief Sink recording on a worker thread while the next cycles compute
+   *
+   * `record` only copies the columns of the populations read by the sinks
+   * into one of `capacity` buffers, and only in the cycles the wrapped sink
+   * records agents, then hands it to the worker, which runs the wrapped sink
+   * on the copy. When every buffer is in flight `record` waits for one, so at
+   * most `capacity` cycles are buffered.
+   *
+   * The states given to `record` must stay at the same address until they
+   * are flushed, and an error of the wrapped sink is rethrown by the next
+   * `record` or `flush`.
+   */
+  class PipelinedSink final : public Sink {
+    struct Frame {
+      State* state;
+      Population<Human> humans;
+      Population<Mosquito> mosquitos;
+    };
+
+    std::shared_ptr<Sink> sink;
+    std::vector<std::unique_ptr<Frame>> free;
+    std::deque<std::unique_ptr<Frame>> queue;
+    std::size_t recording = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+
+    auto work() -> void;
+    auto rethrow() -> void;
+
+  public:
+    explicit PipelinedSink(std::shared_ptr<Sink> sink,
+                           std::size_t capacity = 2);
+    PipelinedSink(const PipelinedSink&) = delete;
+    auto operator=(const PipelinedSink&) -> PipelinedSink& = delete;
+    ~PipelinedSink() override;
+
+    auto record(State& state, const Population<Human>& humans,
+                const Population<Mosquito>& mosquitos) -> void override;
+    [[nodiscard]] auto records_agents(std::size_t cycle) const
+      -> bool override;
+    auto flush() -> void override;
+  };
+} // namespace simulator::output
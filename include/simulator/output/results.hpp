@@ -0,0 +1,155 @@
+#pragma once
+
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/parameters.hpp>
+#include <simulator/population.hpp>
+#include <simulator/state.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace simulator::output {
+  /**
+   * @brief Binary columnar results format
+   *
+   * Native endian file laid out as:
+   *
+   * - `Header`, with the parameters and the master seed
+   * - `Counts` of every cycle, `header.cycles` entries
+   * - agent frames, one every `header.every` cycles (none when `every` is 0),
+   *   each with the columns: human states (u8), human positions (u32),
+   *   mosquito states (u8) and mosquito positions (u32)
+   *
+   * Every block has a fixed offset, so the file is written incrementally and
+   * readers can map it without parsing.
+   */
+  struct Results {
+    static constexpr auto magic =
+      std::array<char, 8> { 'S', 'I', 'M', 'R', 'E', 'S', '0', '1' };
+    static constexpr auto version = std::uint32_t { 2 };
+
+    struct Header {
+      std::array<char, 8> magic;
+      std::uint32_t version;
+      std::uint32_t every;
+      std::uint64_t seed;
+      std::uint64_t cycles;
+      // cycles written, updated when the writer is flushed
+      std::uint64_t recorded;
+      std::uint64_t humans;
+      std::uint64_t mosquitos;
+      Parameters parameters;
+    };
+
+    struct Counts {
+      std::uint64_t cycle;
+      std::array<std::uint64_t, 4> humans;
+      std::array<std::uint64_t, 3> mosquitos;
+      // humans exposed and mosquitos infected during the cycle
+      std::array<std::uint64_t, 2> incidence;
+    };
+
+    [[nodiscard]] static auto counts_offset(std::size_t cycle) noexcept
+      -> std::size_t;
+    [[nodiscard]] static auto frame_size(const Header& header) noexcept
+      -> std::size_t;
+    [[nodiscard]] static auto frame_offset(const Header& header,
+                                           std::size_t frame) noexcept
+      -> std::size_t;
+  };
+
+  /**
+   * @brief Sink that streams the results to a binary file
+   *
+   * The compartment counts of every cycle are written, and every agent state
+   * and position once every `every` cycles, no agent is attached to the
+   * in-memory states. Throws when the file cannot be written.
+   *
+   * When `resume` and `path` has the results of the same simulation, the
+   * file is kept and the cycles recorded again are overwritten in place, so
+   * a simulation resumed from a checkpoint completes the results of the
+   * interrupted one.
+   */
+  class ResultsWriter final : public Sink {
+    std::filesystem::path path;
+    std::ofstream file;
+    Results::Header header;
+
+  public:
+    ResultsWriter(const std::filesystem::path& path,
+                  const Parameters& parameters, std::size_t every = 0,
+                  bool resume = false);
+
+    auto record(State& state, const Population<Human>& humans,
+                const Population<Mosquito>& mosquitos) -> void override;
+    [[nodiscard]] auto records_agents(std::size_t cycle) const
+      -> bool override;
+
+    /**
+     * @brief Write the cycles recorded so far in the header and flush the
+     * file, the header only counts the cycles flushed before it
+     */
+    auto flush() -> void override;
+  };
+
+  /**
+   * @brief Make a sink writing the binary results to `path`
+   *
+   * Agents are recorded according to `mode` as in `make_sink`, except for the
+   * `cohort` mode which the binary format does not support.
+   */
+  [[nodiscard]] auto make_results_writer(const std::filesystem::path& path,
+                                         std::string_view mode,
+                                         std::size_t every,
+                                         const Parameters& parameters,
+                                         bool resume = false)
+    -> std::shared_ptr<ResultsWriter>;
+
+  /**
+   * @brief Memory mapped reader of a binary results file
+   *
+   * Throws when the file is shorter than the cycles its header says are
+   * recorded. The agent columns are only read in the cycles `has_agents`.
+   */
+  class ResultsReader {
+    const std::byte* data = nullptr;
+    std::size_t size = 0;
+
+  public:
+    explicit ResultsReader(const std::filesystem::path& path);
+    ResultsReader(const ResultsReader&) = delete;
+    auto operator=(const ResultsReader&) -> ResultsReader& = delete;
+    ~ResultsReader();
+
+    [[nodiscard]] auto header() const noexcept -> const Results::Header&;
+    [[nodiscard]] auto counts() const noexcept
+      -> std::span<const Results::Counts>;
+
+    /**
+     * @brief Whether the agents were recorded in the cycle (1-based)
+     */
+    [[nodiscard]] auto has_agents(std::size_t cycle) const noexcept -> bool;
+    [[nodiscard]] auto human_states(std::size_t cycle) const noexcept
+      -> std::span<const Human::State>;
+    [[nodiscard]] auto human_positions(std::size_t cycle) const noexcept
+      -> std::span<const std::uint32_t>;
+    [[nodiscard]] auto mosquito_states(std::size_t cycle) const noexcept
+      -> std::span<const Mosquito::State>;
+    [[nodiscard]] auto mosquito_positions(std::size_t cycle) const noexcept
+      -> std::span<const std::uint32_t>;
+
+    /**
+     * @brief Convert back to the in-memory states, a.k.a. the json results
+     */
+    [[nodiscard]] auto states(bool agents = true) const -> std::vector<State>;
+  };
+} // namespace simulator::output
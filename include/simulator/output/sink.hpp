@@ -0,0 +1,140 @@
+#pragma once
+
+#include <simulator/environment.hpp>
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/parameters.hpp>
+#include <simulator/population.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace simulator::output {
+  /**
+   * @brief Decides what is recorded from the agents in each cycle
+   *
+   * The compartment counts are always recorded by the simulation, a sink is
+   * only given the chance to attach agents to the state of the cycle.
+   */
+  class Sink {
+  public:
+    virtual ~Sink() = default;
+
+    virtual auto record(State& state, const Population<Human>& humans,
+                        const Population<Mosquito>& mosquitos) -> void = 0;
+
+    /**
+     * @brief Whether `record` reads the agents in the cycle (1-based)
+     *
+     * In the other cycles `record` only reads the state, and the populations
+     * it is given may be stale, so the callers and the wrapping sinks skip
+     * preparing them. `record` only reads the states, positions, counters
+     * and changes of the populations.
+     */
+    [[nodiscard]] virtual auto records_agents(std::size_t /*cycle*/) const
+      -> bool {
+      return true;
+    }
+
+    /**
+     * @brief Wait until every recorded cycle is attached to its state and
+     * written out, called when the run ends or `iterate` runs out of cycles
+     */
+    virtual auto flush() -> void {}
+  };
+
+  /**
+   * @brief Only the compartment counts, O(cycles) memory
+   */
+  class AggregateSink final : public Sink {
+  public:
+    auto record(State& state, const Population<Human>& humans,
+                const Population<Mosquito>& mosquitos) -> void override;
+    [[nodiscard]] auto records_agents(std::size_t cycle) const
+      -> bool override;
+  };
+
+  /**
+   * @brief Every agent, once every `every` cycles
+   */
+  class SnapshotSink final : public Sink {
+    std::size_t every;
+
+  public:
+    explicit SnapshotSink(std::size_t every = 1);
+    auto record(State& state, const Population<Human>& humans,
+                const Population<Mosquito>& mosquitos) -> void override;
+    [[nodiscard]] auto records_agents(std::size_t cycle) const
+      -> bool override;
+  };
+
+  /**
+   * @brief A fixed cohort of agents, every cycle
+   */
+  class CohortSink final : public Sink {
+    std::vector<std::size_t> humans;
+    std::vector<std::size_t> mosquitos;
+
+  public:
+    CohortSink(std::vector<std::size_t> humans,
+               std::vector<std::size_t> mosquitos);
+
+    /**
+     * @brief Sample a cohort of `size` humans and `size` mosquitos
+     *
+     * The ids are drawn with the master seed of the parameters, so the same
+     * seed always follows the same agents.
+     */
+    [[nodiscard]] static auto sample(const Parameters& parameters,
+                                     std::size_t size) -> CohortSink;
+
+    auto record(State& state, const Population<Human>& humans,
+                const Population<Mosquito>& mosquitos) -> void override;
+  };
+
+  /**
+   * @brief Sink reporting the positions of a renumbered environment in the
+   * input ids
+   *
+   * In the cycles the wrapped sink records agents, the columns it reads are
+   * copied with the positions translated, in the other cycles the
+   * populations are passed through.
+   */
+  class RenumberedSink final : public Sink {
+    std::shared_ptr<Sink> sink;
+    Environment environment;
+    Population<Human> humans { 0 };
+    Population<Mosquito> mosquitos { 0 };
+
+  public:
+    RenumberedSink(std::shared_ptr<Sink> sink, Environment environment);
+
+    auto record(State& state, const Population<Human>& humans,
+                const Population<Mosquito>& mosquitos) -> void override;
+    [[nodiscard]] auto records_agents(std::size_t cycle) const
+      -> bool override;
+    auto flush() -> void override;
+  };
+
+  /**
+   * @brief Wrap `sink` in a `RenumberedSink` when the environment is
+   * renumbered and the sink records agents
+   */
+  [[nodiscard]] auto renumbered(std::shared_ptr<Sink> sink,
+                                const Environment& environment)
+    -> std::shared_ptr<Sink>;
+
+  /**
+   * @brief Make a sink from its command line name
+   *
+   * `mode` is one of `aggregate`, `snapshot` (every `every` cycles), `cohort`
+   * (`cohort` agents of each kind), `full` or `history` (a `HistorySink` with
+   * a keyframe every `every` cycles).
+   */
+  [[nodiscard]] auto make_sink(std::string_view mode, std::size_t every,
+                               std::size_t cohort, const Parameters& parameters)
+    -> std::shared_ptr<Sink>;
+} // namespace simulator::output
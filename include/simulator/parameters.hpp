@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string_view>
 
 namespace simulator {
@@ -22,8 +24,17 @@ namespace simulator {
     std::size_t mosquito_initial_recovered;
     std::size_t mosquito_transition_period_infected;
     std::size_t mosquito_transition_period_recovered;
+    std::uint64_t seed;
 
-    static auto from_json(const std::string_view) -> Parameters;
+    /**
+     * @brief Parse the parameters, sampling each range with the master seed
+     *
+     * The seed is taken from the argument, then from the `seed` key of the
+     * json, and is only drawn from `std::random_device` when neither is set.
+     */
+    static auto from_json(const std::string_view,
+                          std::optional<std::uint64_t> seed = std::nullopt)
+      -> Parameters;
   };
 
 } // namespace simulator
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+namespace simulator {
+  /**
+   * @brief Structure of arrays storage for a population of agents
+   *
+   * Each field lives in its own narrow array, so every phase only streams
+   * through the fields it needs. `Agent` (`Human` or `Mosquito`) is only used
+   * as a view for serialization.
+   *
+   * The agents are indexed by slot. The slot of an agent is its id until the
+   * population is first permuted, then `ids` and `slots` map between them.
+   */
+  template <typename Agent>
+  struct Population {
+    using State = typename Agent::State;
+
+    /**
+     * @brief What changed for an agent in the current cycle, set by the
+     * phases and cleared after the output
+     */
+    enum Change : std::uint8_t {
+      Unchanged = 0,
+      StateChanged = 1,
+      PositionChanged = 2,
+      // moved to `next_positions`, becomes `PositionChanged` in the next cycle
+      NextPositionChanged = 4
+    };
+
+    std::vector<State> states;
+    std::vector<std::uint32_t> positions;
+    std::vector<std::uint32_t> counters;
+    std::vector<std::uint8_t> changes;
+    // states of the next cycle written by the contact, committed to `states`
+    // once every cell is done
+    std::vector<State> next_states;
+    // positions of the next cycle, only allocated by the fused execution
+    std::vector<std::uint32_t> next_positions;
+    // id of the agent in each slot and slot of each id, empty until the
+    // population is first permuted
+    std::vector<std::uint32_t> ids;
+    std::vector<std::uint32_t> slots;
+
+    explicit Population(std::size_t size)
+      : states(size), positions(size), counters(size), changes(size),
+        next_states(size) {}
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+      return states.size();
+    }
+
+    auto insert(std::size_t id, State state, std::size_t position) noexcept
+      -> void {
+      states[id] = state;
+      positions[id] = static_cast<std::uint32_t>(position);
+      counters[id] = 0;
+    }
+
+    /**
+     * @brief Id of the agent in a slot
+     */
+    [[nodiscard]] auto id(std::size_t slot) const noexcept -> std::size_t {
+      return ids.empty() ? slot : ids[slot];
+    }
+
+    /**
+     * @brief Move the agent in slot `order[k]` to slot `k`
+     *
+     * The next states and positions are scratch columns and are not moved.
+     */
+    auto permute(const std::vector<std::size_t>& order) -> void {
+      if (ids.empty()) {
+        ids.resize(size());
+        std::iota(std::begin(ids), std::end(ids), 0U);
+        slots = ids;
+      }
+
+      const auto gather = [&order](auto& column) {
+        auto permuted = std::vector<typename std::remove_reference_t<
+          decltype(column)>::value_type>(column.size());
+        std::transform(std::execution::par_unseq, std::begin(order),
+                       std::end(order), std::begin(permuted),
+                       [&column](auto slot) { return column[slot]; });
+        column.swap(permuted);
+      };
+      gather(states);
+      gather(positions);
+      gather(counters);
+      gather(changes);
+      gather(ids);
+
+      std::for_each(std::execution::par_unseq, std::begin(ids), std::end(ids),
+                    [this](const auto& id) {
+                      slots[id] = static_cast<std::uint32_t>(&id - ids.data());
+                    });
+    }
+
+    /**
+     * @brief Copy the agents to `population` in id order
+     */
+    auto unpermute(Population& population) const -> void {
+      const auto gather = [this](auto& to, const auto& from) {
+        to.resize(from.size());
+        std::transform(std::execution::par_unseq, std::begin(slots),
+                       std::end(slots), std::begin(to),
+                       [&from](auto slot) { return from[slot]; });
+      };
+      gather(population.states, states);
+      gather(population.positions, positions);
+      gather(population.counters, counters);
+      gather(population.changes, changes);
+    }
+
+    /**
+     * @brief Get a view of an agent, a.k.a. the agent as it is serialized
+     */
+    [[nodiscard]] auto operator[](std::size_t id) const noexcept -> Agent {
+      return Agent { states[id], id, positions[id], counters[id] };
+    }
+  };
+} // namespace simulator
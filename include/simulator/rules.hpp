@@ -0,0 +1,99 @@
+#pragma once
+
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/parameters.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simulator {
+  /**
+   * @brief Advance the state of a human by one cycle, returns whether the
+   * state changed
+   */
+  constexpr auto transition(Human::State& state, std::uint32_t& counter,
+                            const Parameters& parameters) noexcept -> bool {
+    const auto advance = [&state, &counter](auto period,
+                                            auto next) noexcept {
+      if (counter >= period) {
+        state = next;
+        counter = 0;
+        return true;
+      }
+      counter++;
+      return false;
+    };
+
+    switch (state) {
+      case Human::State::Exposed:
+        return advance(parameters.human_transition_period_exposed,
+                       Human::State::Infected);
+      case Human::State::Infected:
+        return advance(parameters.human_transition_period_infected,
+                       Human::State::Recovered);
+      case Human::State::Recovered:
+        return advance(parameters.human_transition_period_recovered,
+                       Human::State::Susceptible);
+      case Human::State::Susceptible:
+        counter++;
+        break;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Advance the state of a mosquito by one cycle, returns whether the
+   * state changed
+   */
+  constexpr auto transition(Mosquito::State& state, std::uint32_t& counter,
+                            const Parameters& parameters) noexcept -> bool {
+    const auto advance = [&state, &counter](auto period,
+                                            auto next) noexcept {
+      if (counter >= period) {
+        state = next;
+        counter = 0;
+        return true;
+      }
+      counter++;
+      return false;
+    };
+
+    switch (state) {
+      case Mosquito::State::Infected:
+        return advance(parameters.mosquito_transition_period_infected,
+                       Mosquito::State::Recovered);
+      case Mosquito::State::Recovered:
+        return advance(parameters.mosquito_transition_period_recovered,
+                       Mosquito::State::Susceptible);
+      case Mosquito::State::Susceptible:
+        counter++;
+        break;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Whether the agent `target` is infected in `cycle` by one of the
+   * `infectious` agents in the `sources` slots of `population`
+   *
+   * Every draw is keyed by the (target, source) ids, so an agent meeting
+   * several infectious agents gets an independent draw for each one of them
+   * and the result does not depend on the order of the sources.
+   */
+  template <typename Population, typename Sources, typename Random>
+  constexpr auto infected_by(std::size_t cycle, std::size_t target,
+                             const Sources& sources,
+                             const Population& population,
+                             typename Population::State infectious,
+                             const Random& random, double rate) noexcept
+    -> bool {
+    for (const auto& source : sources) {
+      if (population.states[source] == infectious &&
+          random(cycle, target, population.id(source)) < rate) {
+        return true;
+      }
+    }
+    return false;
+  }
+} // namespace simulator
@@ -1,55 +1,147 @@
 #pragma once
 
+#include <simulator/checkpoint.hpp>
 #include <simulator/environment.hpp>
+#include <simulator/execution.hpp>
+#include <simulator/frontier.hpp>
 #include <simulator/human.hpp>
 #include <simulator/mosquito.hpp>
+#include <simulator/occupancy.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/population.hpp>
 #include <simulator/parameters.hpp>
 #include <simulator/state.hpp>
 
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <exec/on.hpp>
 #include <exec/static_thread_pool.hpp>
-#include <nvexec/multi_gpu_context.cuh>
 #include <stdexec/execution.hpp>
+#ifndef SIMULATOR_HOST_ONLY
+  #include <nvexec/multi_gpu_context.cuh>
+#endif
 
 namespace simulator {
   class Simulation {
     std::size_t iteration = 0;
+    // cycle the simulation was started or resumed from
+    std::size_t resumed = 0;
 
     std::shared_ptr<const Environment> environment;
     std::shared_ptr<const Parameters> parameters;
+    std::uint64_t seed;
+    std::size_t replicas;
+    Execution execution;
 
+#ifndef SIMULATOR_HOST_ONLY
     nvexec::stream_context gpu;
-    exec::static_thread_pool cpu;
+#endif
+    std::shared_ptr<exec::static_thread_pool> cpu;
+    // one pool per NUMA node, replacing `cpu` with the numa execution
+    std::vector<std::shared_ptr<exec::static_thread_pool>> nodes;
 
-    std::unique_ptr<std::vector<Human>> humans;
-    std::unique_ptr<std::vector<Mosquito>> mosquitos;
-    std::unique_ptr<std::vector<
-      std::pair<std::vector<std::int64_t>, std::vector<std::int64_t>>>>
-      agents_in_position;
+    std::unique_ptr<Population<Human>> humans;
+    std::unique_ptr<Population<Mosquito>> mosquitos;
+    std::unique_ptr<Occupancy> humans_in_position;
+    std::unique_ptr<Occupancy> mosquitos_in_position;
+    std::unique_ptr<Frontier> frontier;
+    // the populations in id order, recorded instead of the sorted ones
+    std::unique_ptr<Population<Human>> ordered_humans;
+    std::unique_ptr<Population<Mosquito>> ordered_mosquitos;
 
-    std::unique_ptr<std::vector<State>> states;
+    // compartment counts of every replica, updated with the state changes
+    // (flows) counted by the contact and transition kernels in each cycle
+    std::vector<std::size_t> counts;
+    std::vector<std::size_t> flows;
 
+    // one vector of states per replica
+    std::unique_ptr<std::vector<std::vector<State>>> states;
+    std::shared_ptr<output::Sink> sink;
+
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    std::size_t checkpoint_interval = 0;
+
+    /**
+     * @brief Run kernels concurrently on `placement`, each kernel is a bulk
+     * over `first` indices
+     */
+    template <typename... Kernels>
+    auto launch(Placement placement,
+                std::pair<std::size_t, Kernels>... kernels) noexcept -> void;
+
+    /**
+     * @brief Move a column to memory first touched by the pools of the NUMA
+     * nodes, each one touching its share of the column
+     */
+    template <typename T>
+    auto place(std::vector<T>& column) noexcept -> void;
+
+    [[nodiscard]] auto step() -> const State&;
     auto insertion() noexcept -> void;
+    auto reindex() noexcept -> void;
     auto movement() noexcept -> void;
     auto contact() noexcept -> void;
     auto transition() noexcept -> void;
-    [[nodiscard]] auto output() noexcept -> const State&;
+    auto fused() noexcept -> void;
+    auto sort() noexcept -> void;
+    template <typename Agent>
+    [[nodiscard]] auto recorded(const Population<Agent>& population,
+                                Population<Agent>& ordered) const
+      -> const Population<Agent>&;
+    [[nodiscard]] auto output() -> const State&;
+    [[nodiscard]] auto snapshot() const -> std::unique_ptr<const Checkpoint>;
 
   public:
-    Simulation(
-      std::shared_ptr<const Environment> environment,
-      std::shared_ptr<const Parameters> parameters,
-      std::size_t threads = std::thread::hardware_concurrency()) noexcept;
+    /**
+     * @brief Create a simulation
+     *
+     * `sink` decides which agents are recorded in each cycle state, when null
+     * every agent is recorded in every cycle. The agents of the states are
+     * complete once `run` returns or `iterate` returns no state.
+     *
+     * With more than one replica, the replicas are batched in the same
+     * populations (agent `i` of replica `r` has the id `r * size + i`) and
+     * each phase is a single bulk over all of them. Batched replicas share the
+     * parameters, draw independent random numbers and only record the
+     * compartment counts, `sink` is then ignored.
+     *
+     * `execution` places each phase on the synchronous algorithms, the thread
+     * pool or the gpu. With the numa execution, the thread pool is replaced
+     * by one pool per NUMA node with a worker per cpu of its node, except for
+     * a simulation given an external pool.
+     */
+    Simulation(std::shared_ptr<const Environment> environment,
+               std::shared_ptr<const Parameters> parameters,
+               std::size_t threads = std::thread::hardware_concurrency(),
+               std::shared_ptr<output::Sink> sink = nullptr,
+               std::size_t replicas = 1, Execution execution = {}) noexcept;
+    /**
+     * @brief Create a simulation running its cpu phases on an externally owned
+     * pool, so concurrent simulations share the same threads
+     */
+    Simulation(std::shared_ptr<const Environment> environment,
+               std::shared_ptr<const Parameters> parameters,
+               std::shared_ptr<exec::static_thread_pool> pool,
+               std::shared_ptr<output::Sink> sink = nullptr,
+               std::size_t replicas = 1, Execution execution = {}) noexcept;
+    /**
+     * @brief Wait for the sink to record the cycles it still holds, as they
+     * point into the states of the simulation
+     */
+    ~Simulation();
     /**
      * @brief Run the simulation
      *
      * This method runs all the simulation steps until the end of the simulation
+     *
+     * Throws the error of a sink failing to record a cycle.
      */
-    auto run() noexcept -> void;
+    auto run() -> void;
 
     /**
      * @brief Prepare the simulation
@@ -58,20 +150,46 @@ namespace simulator {
      */
     auto prepare() noexcept -> void;
 
+    /**
+     * @brief Save a checkpoint to `path` every `every` cycles, never when 0
+     *
+     * The agents are copied at the end of the cycle and saved on a worker
+     * thread while the next cycles run. The sink is flushed first, so the
+     * results it writes hold every cycle of a saved checkpoint. A checkpoint
+     * failing to save is thrown by the next one, or at the end of the run.
+     */
+    auto checkpoint(const std::filesystem::path& path, std::size_t every)
+      -> void;
+
+    /**
+     * @brief Prepare the simulation to continue from a checkpoint, instead
+     * of `prepare`
+     *
+     * With the same parameters and seed, the simulation continues exactly as
+     * the checkpointed one, whatever its execution. The states of the cycles
+     * before the checkpoint only have their counts, the sink records the
+     * agents from the checkpoint on. Throws if `path` is not a checkpoint of
+     * this simulation.
+     */
+    auto resume(const std::filesystem::path& path) -> void;
+
     /**
      * @brief Iterate the simulation
      *
      * This method runs one iteration of the simulation and returns the state
+     *
+     * Throws the error of a sink failing to record a cycle.
      */
-    [[nodiscard]] auto iterate() noexcept -> std::optional<const State* const>;
+    [[nodiscard]] auto iterate() -> std::optional<const State* const>;
 
     /**
      * @brief Get the states of the simulation, a.k.a. the results
      *
-     * This method returns the states of the simulation
+     * This method returns the states of a replica of the simulation
      *
      * @return The states of the simulation
      */
-    [[nodiscard]] auto get_states() noexcept -> const std::vector<State>&;
+    [[nodiscard]] auto get_states(std::size_t replica = 0) noexcept
+      -> const std::vector<State>&;
   };
 } // namespace simulator
@@ -17,6 +17,8 @@ namespace simulator {
     std::tuple<std::size_t, std::size_t, std::size_t, std::size_t>
       humans_in_states;
     std::tuple<std::size_t, std::size_t, std::size_t> mosquitos_in_states;
+    // humans exposed and mosquitos infected during the cycle
+    std::pair<std::size_t, std::size_t> incidence;
     std::vector<Human> humans;
     std::vector<Mosquito> mosquitos;
 
@@ -27,6 +29,7 @@ namespace simulator {
 
   NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(State, progress,
                                                   humans_in_states,
-                                                  mosquitos_in_states, humans,
+                                                  mosquitos_in_states,
+                                                  incidence, humans,
                                                   mosquitos);
 } // namespace simulator
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace simulator::util {
+  /**
+   * @brief Cpus of each NUMA node the process may run on
+   *
+   * Read from `/sys/devices/system/node`, a machine without NUMA (or without
+   * sysfs) is a single node with every allowed cpu. Nodes without an allowed
+   * cpu are left out.
+   */
+  struct Topology {
+    std::vector<std::vector<unsigned>> nodes;
+
+    [[nodiscard]] static auto detect() -> Topology;
+  };
+
+  /**
+   * @brief Restrict the calling thread to `cpus`, returns the cpus it was
+   * allowed on before
+   *
+   * Threads started afterwards inherit the restriction.
+   */
+  auto bind(std::span<const unsigned> cpus) -> std::vector<unsigned>;
+
+  /**
+   * @brief Give back the pages of a zeroed buffer, so each page is placed on
+   * the node of the thread touching it first
+   *
+   * Only the whole pages within the buffer are released, they read as zeros
+   * until touched again.
+   */
+  auto release(void* data, std::size_t bytes) noexcept -> void;
+} // namespace simulator::util
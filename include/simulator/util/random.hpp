@@ -1,14 +1,14 @@
 #pragma once
 
+#include <array>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <functional>
 #include <random>
 #include <type_traits>
 
-#include <thrust/random.h>
-
 namespace simulator::util {
 
   template <typename T>
@@ -27,23 +27,87 @@ namespace simulator::util {
     }
   }
 
+  /**
+   * @brief Philox4x32-10 counter based random number generator
+   *
+   * Stateless bijection from a 128 bit counter to 128 random bits under a 64
+   * bit key, any draw can be computed in O(1) without skipping ahead.
+   */
+  constexpr auto philox(std::array<std::uint32_t, 4> counter,
+                        std::array<std::uint32_t, 2> key) noexcept
+    -> std::array<std::uint32_t, 4> {
+    constexpr auto multiplier0 = 0xD2511F53UL;
+    constexpr auto multiplier1 = 0xCD9E8D57UL;
+    constexpr auto weyl0 = 0x9E3779B9U;
+    constexpr auto weyl1 = 0xBB67AE85U;
+
+    for (auto round = 0; round < 10; round++) {
+      const auto product0 = multiplier0 * counter[0];
+      const auto product1 = multiplier1 * counter[2];
+      counter = { static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^
+                    key[0],
+                  static_cast<std::uint32_t>(product1),
+                  static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^
+                    key[1],
+                  static_cast<std::uint32_t>(product0) };
+      key = { key[0] + weyl0, key[1] + weyl1 };
+    }
+
+    return counter;
+  }
+
+  /**
+   * @brief Independent random streams, one for each kind of draw
+   */
+  enum struct Stream : std::uint32_t {
+    Parameters,
+    Cohort,
+    HumanInsertion,
+    MosquitoInsertion,
+    HumanMovement,
+    MosquitoMovement,
+    HumanContact,
+    MosquitoContact,
+    MosquitoMosquitoContact,
+    Replicas,
+    HumanPressure,
+    MosquitoPressure
+  };
+
+  /**
+   * @brief Make a counter based random number generator
+   *
+   * The returned callable maps `(cycle, agent, draw)` to a uniformly
+   * distributed value in `[min, max]`, independent streams are selected by
+   * `stream` so that different phases never share draws.
+   */
   template <typename T>
     requires std::is_arithmetic_v<T>
-  auto make_gpu_rng(T min, T max, std::size_t seed) noexcept {
-    if constexpr (std::is_integral_v<T>) {
-      return [min, max, seed](std::size_t idx) mutable noexcept {
-        thrust::default_random_engine rng(seed);
-        thrust::uniform_int_distribution<T> dist(min, max);
-        rng.discard(idx);
-        return dist(rng);
-      };
-    } else {
-      return [min, max, seed](std::size_t idx) mutable noexcept {
-        thrust::default_random_engine rng(seed);
-        thrust::uniform_real_distribution<T> dist(min, max);
-        rng.discard(idx);
-        return dist(rng);
-      };
-    }
+  auto make_counter_rng(T min, T max, std::uint64_t seed,
+                        Stream stream) noexcept {
+    const auto key = std::array<std::uint32_t, 2> {
+      static_cast<std::uint32_t>(seed),
+      static_cast<std::uint32_t>(seed >> 32) ^
+        (static_cast<std::uint32_t>(stream) * 0x9E3779B9U)
+    };
+
+    return [min, max, key](std::uint64_t cycle, std::uint64_t agent,
+                           std::uint64_t draw = 0) noexcept -> T {
+      const auto bits = philox({ static_cast<std::uint32_t>(agent),
+                                 static_cast<std::uint32_t>(agent >> 32),
+                                 static_cast<std::uint32_t>(cycle),
+                                 static_cast<std::uint32_t>(draw) },
+                               key);
+      const auto value = (static_cast<std::uint64_t>(bits[0]) << 32) | bits[1];
+
+      if constexpr (std::is_integral_v<T>) {
+        const auto range = static_cast<std::uint64_t>(max - min) + 1;
+        return range == 0 ? static_cast<T>(value)
+                          : min + static_cast<T>(value % range);
+      } else {
+        return min + (max - min) * static_cast<T>(value >> 11) *
+          static_cast<T>(0x1.0p-53);
+      }
+    };
   }
 } // namespace simulator::util
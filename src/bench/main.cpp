@@ -1,11 +1,17 @@
 #include <simulator/environment.hpp>
+#include <simulator/execution.hpp>
 #include <simulator/parameters.hpp>
+#include <simulator/output/pipeline.hpp>
+#include <simulator/output/sink.hpp>
 #include <simulator/simulation.hpp>
 
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <utility>
 
 #include <argparse/argparse.hpp>
 
@@ -33,30 +39,139 @@ auto main(int argc, char* argv[]) -> int {
       return std::stoul(value);
     });
 
+  program.add_argument("-r", "--replicas")
+    .help("Replicas batched in the simulation, only counts are recorded")
+    .default_value(1UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("-s", "--seed")
+    .help("Master seed, runs with the same seed are reproducible")
+    .action([](const std::string& value) -> std::uint64_t {
+      return std::stoull(value);
+    });
+
+  program.add_argument("-m", "--output-mode")
+    .help("Agents recorded each cycle: aggregate, snapshot, cohort, full or "
+          "history")
+    .default_value(std::string("full"))
+    .choices("aggregate", "snapshot", "cohort", "full", "history");
+
+  program.add_argument("--every")
+    .help("Cycles between snapshots in snapshot mode, or between keyframes "
+          "in history mode")
+    .default_value(1UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("--cohort")
+    .help("Number of humans and mosquitos followed in cohort mode")
+    .default_value(100UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("--pipeline")
+    .help("Record the agents on a worker thread while the next cycles run")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--fused")
+    .help("Fuse the transition, counting and next movement in one pass")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--aggregated")
+    .help("Use the aggregated infection pressure of each cell for contact")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--sort-every")
+    .help("Cycles between sorts of the agents by cell, 0 to never sort")
+    .default_value(0UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+#ifdef SIMULATOR_HOST_ONLY
+  // the gpu build allocates the columns in managed memory
+  program.add_argument("--numa")
+    .help("Run the cpu phases on one pinned pool per NUMA node")
+    .default_value(false)
+    .implicit_value(true);
+#endif
+
+  program.add_argument("--ordering")
+    .help("Numbering of the environment nodes: input, rcm or hilbert")
+    .default_value(std::string("input"))
+    .choices("input", "rcm", "hilbert");
+
+  program.add_argument("-e", "--execution")
+    .help("Placement of every phase: sync, cpu or gpu")
+    .default_value(std::string("gpu"))
+    .choices("sync", "cpu", "gpu");
+
+  for (const auto* phase :
+       { "--insertion", "--movement", "--contact", "--transition" }) {
+    program.add_argument(phase)
+      .help("Placement of the phase, overrides --execution")
+      .choices("sync", "cpu", "gpu");
+  }
+
   try {
     program.parse_args(argc, argv);
 
     const auto input_path = program.get<fs::path>("--input");
     const auto output_path = program.get<fs::path>("--output");
     const auto threads = program.get<std::size_t>("--threads");
+    const auto replicas = program.get<std::size_t>("--replicas");
+    auto execution = simulator::Execution::from_strings(
+      program.get<std::string>("--execution"), program.present("--insertion"),
+      program.present("--movement"), program.present("--contact"),
+      program.present("--transition"));
+    execution.fused = program.get<bool>("--fused");
+    execution.aggregated = program.get<bool>("--aggregated");
+    execution.sort_interval = program.get<std::size_t>("--sort-every");
+#ifdef SIMULATOR_HOST_ONLY
+    execution.numa = program.get<bool>("--numa");
+#endif
+    const auto ordering =
+      simulator::parse_ordering(program.get<std::string>("--ordering"));
+    const auto seed = program.present<std::uint64_t>("--seed");
+    const auto output_mode = program.get<std::string>("--output-mode");
+    const auto every = program.get<std::size_t>("--every");
+    const auto cohort = program.get<std::size_t>("--cohort");
+    const auto pipeline = program.get<bool>("--pipeline");
+
+    const auto pipelined = [pipeline](
+                             std::shared_ptr<simulator::output::Sink> sink)
+      -> std::shared_ptr<simulator::output::Sink> {
+      if (!pipeline) {
+        return sink;
+      }
+      return std::make_shared<simulator::output::PipelinedSink>(
+        std::move(sink));
+    };
 
-    auto environment_input_file =
-      std::ifstream { fs::path { input_path } / "environment.json" };
     auto parameters_input_file =
       std::ifstream { fs::path { input_path } / "parameters.json" };
-    const auto environment_data =
-      std::string { std::istreambuf_iterator<char> { environment_input_file },
-                    std::istreambuf_iterator<char> {} };
     const auto parameters_data =
       std::string { std::istreambuf_iterator<char> { parameters_input_file },
                     std::istreambuf_iterator<char> {} };
-    const auto parameters = simulator::Parameters::from_json(parameters_data);
+    const auto parameters =
+      simulator::Parameters::from_json(parameters_data, seed);
     const auto environment =
-      simulator::Environment::from_geojson(environment_data);
+      simulator::Environment::load(input_path).reorder(ordering);
     /*std::cout  << environment.size << std::endl;*/
     auto simulation = simulator::Simulation(
       std::make_shared<simulator::Environment>(environment),
-      std::make_shared<simulator::Parameters>(parameters), threads);
+      std::make_shared<simulator::Parameters>(parameters), threads,
+      pipelined(simulator::output::renumbered(
+        simulator::output::make_sink(output_mode, every, cohort, parameters),
+        environment)),
+      replicas, execution);
     simulation.run();
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
@@ -0,0 +1,55 @@
+#include <simulator/output/results.hpp>
+#include <simulator/state.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <argparse/argparse.hpp>
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+
+auto main(int argc, char* argv[]) -> int {
+  argparse::ArgumentParser program("results", "v1.0.0");
+
+  program.add_argument("-i", "--input")
+    .help("Binary results file")
+    .required()
+    .action([](const std::string& value) -> fs::path { return value; });
+
+  program.add_argument("-o", "--output")
+    .help("Json results file, the standard output when not given")
+    .action([](const std::string& value) -> fs::path { return value; });
+
+  program.add_argument("--counts")
+    .help("Only convert the compartment counts")
+    .default_value(false)
+    .implicit_value(true);
+
+  try {
+    program.parse_args(argc, argv);
+
+    const auto input_path = program.get<fs::path>("--input");
+    const auto output_path = program.present<fs::path>("--output");
+
+    const auto reader = simulator::output::ResultsReader(input_path);
+    nlohmann::json json_results =
+      reader.states(!program.get<bool>("--counts"));
+
+    if (output_path.has_value()) {
+      if (output_path->has_parent_path()) {
+        fs::create_directories(output_path->parent_path());
+      }
+      std::ofstream output_file(output_path.value());
+      output_file << json_results.dump(2);
+    } else {
+      std::cout << json_results.dump(2) << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
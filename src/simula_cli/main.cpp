@@ -1,18 +1,32 @@
 #include "indicators/setting.hpp"
 #include <memory>
+#include <simulator/checkpoint.hpp>
 #include <simulator/environment.hpp>
+#include <simulator/execution.hpp>
 #include <simulator/parameters.hpp>
+#include <simulator/output/history.hpp>
+#include <simulator/output/results.hpp>
+#include <simulator/output/pipeline.hpp>
+#include <simulator/output/sink.hpp>
 #include <simulator/simulation.hpp>
 #include <simulator/util/random.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <optional>
+#include <semaphore>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <argparse/argparse.hpp>
+#include <exec/static_thread_pool.hpp>
 #include <indicators/dynamic_progress.hpp>
 #include <indicators/progress_bar.hpp>
 
@@ -31,6 +45,114 @@ auto main(int argc, char* argv[]) -> int {
     .default_value(std::string("./assets/output"))
     .action([](const std::string& value) -> fs::path { return value; });
 
+  program.add_argument("-s", "--seed")
+    .help("Master seed, runs with the same seed are reproducible")
+    .action([](const std::string& value) -> std::uint64_t {
+      return std::stoull(value);
+    });
+
+  program.add_argument("-m", "--output-mode")
+    .help("Agents recorded each cycle: aggregate, snapshot, cohort, full or "
+          "history")
+    .default_value(std::string("full"))
+    .choices("aggregate", "snapshot", "cohort", "full", "history");
+
+  program.add_argument("--every")
+    .help("Cycles between snapshots in snapshot mode, or between keyframes "
+          "in history mode")
+    .default_value(1UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("-f", "--format")
+    .help("Results format: json, or binary (see simulator/output/results.hpp)")
+    .default_value(std::string("json"))
+    .choices("json", "binary");
+
+  program.add_argument("--cohort")
+    .help("Number of humans and mosquitos followed in cohort mode")
+    .default_value(100UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("-t", "--threads")
+    .help("Threads of the pool shared by every simulation")
+    .default_value(
+      static_cast<std::size_t>(std::thread::hardware_concurrency()))
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("-j", "--jobs")
+    .help("Simulations running at once")
+    .default_value(
+      static_cast<std::size_t>(std::thread::hardware_concurrency()))
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("--pipeline")
+    .help("Record the agents on a worker thread while the next cycles run")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--fused")
+    .help("Fuse the transition, counting and next movement in one pass")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--aggregated")
+    .help("Use the aggregated infection pressure of each cell for contact")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--sort-every")
+    .help("Cycles between sorts of the agents by cell, 0 to never sort")
+    .default_value(0UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+#ifdef SIMULATOR_HOST_ONLY
+  // the gpu build allocates the columns in managed memory
+  program.add_argument("--numa")
+    .help("Run the cpu phases on one pinned pool per NUMA node")
+    .default_value(false)
+    .implicit_value(true);
+#endif
+
+  program.add_argument("--checkpoint-every")
+    .help("Cycles between checkpoints of each simulation, 0 to never save one")
+    .default_value(0UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("--resume")
+    .help("Continue each simulation from its checkpoint, when it has one, "
+          "with the seed of the checkpoint unless --seed is given")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--ordering")
+    .help("Numbering of the environment nodes: input, rcm or hilbert")
+    .default_value(std::string("input"))
+    .choices("input", "rcm", "hilbert");
+
+  program.add_argument("-e", "--execution")
+    .help("Placement of every phase: sync, cpu or gpu")
+    .default_value(std::string("gpu"))
+    .choices("sync", "cpu", "gpu");
+
+  for (const auto* phase :
+       { "--insertion", "--movement", "--contact", "--transition" }) {
+    program.add_argument(phase)
+      .help("Placement of the phase, overrides --execution")
+      .choices("sync", "cpu", "gpu");
+  }
+
   try {
     auto progress_bars = indicators::DynamicProgress<indicators::ProgressBar>();
     program.parse_args(argc, argv);
@@ -38,33 +160,109 @@ auto main(int argc, char* argv[]) -> int {
 
     const auto input_path = program.get<std::string>("--input");
     const auto output_path = program.get<std::string>("--output");
+    const auto seed = program.present<std::uint64_t>("--seed");
+    const auto output_mode = program.get<std::string>("--output-mode");
+    const auto every = program.get<std::size_t>("--every");
+    const auto cohort = program.get<std::size_t>("--cohort");
+    const auto format = program.get<std::string>("--format");
+    const auto pipeline = program.get<bool>("--pipeline");
+
+    const auto pipelined = [pipeline](
+                             std::shared_ptr<simulator::output::Sink> sink)
+      -> std::shared_ptr<simulator::output::Sink> {
+      if (!pipeline) {
+        return sink;
+      }
+      return std::make_shared<simulator::output::PipelinedSink>(
+        std::move(sink));
+    };
+    auto execution = simulator::Execution::from_strings(
+      program.get<std::string>("--execution"), program.present("--insertion"),
+      program.present("--movement"), program.present("--contact"),
+      program.present("--transition"));
+    execution.fused = program.get<bool>("--fused");
+    execution.aggregated = program.get<bool>("--aggregated");
+    execution.sort_interval = program.get<std::size_t>("--sort-every");
+#ifdef SIMULATOR_HOST_ONLY
+    execution.numa = program.get<bool>("--numa");
+#endif
+    const auto checkpoint_every =
+      program.get<std::size_t>("--checkpoint-every");
+    const auto resume = program.get<bool>("--resume");
+    // a history is keyed by the cycles from the first one on
+    if (output_mode == "history" && (checkpoint_every != 0 || resume)) {
+      throw std::invalid_argument("a history is recorded without checkpoints");
+    }
+    const auto ordering =
+      simulator::parse_ordering(program.get<std::string>("--ordering"));
+    const auto threads = program.get<std::size_t>("--threads");
+    const auto jobs = program.get<std::size_t>("--jobs");
+
+    // every simulation runs on the same pool, and at most `jobs` of them are
+    // running at once
+    const auto pool = std::make_shared<exec::static_thread_pool>(
+      static_cast<std::uint32_t>(threads));
+    auto slots = std::counting_semaphore<> {
+      static_cast<std::ptrdiff_t>(std::max(jobs, 1UL))
+    };
 
     std::vector<std::future<void>> futures;
     for (fs::path simulation_path : fs::directory_iterator(input_path)) {
-      auto environment_input_file =
-        std::ifstream { simulation_path / "environment.json" };
       auto parameters_input_file =
         std::ifstream { simulation_path / "parameters.json" };
 
-      const auto environment_data =
-        std::string { std::istreambuf_iterator<char> { environment_input_file },
-                      std::istreambuf_iterator<char> {} };
       const auto parameters_data =
         std::string { std::istreambuf_iterator<char> { parameters_input_file },
                       std::istreambuf_iterator<char> {} };
 
-      const auto parameters = simulator::Parameters::from_json(parameters_data);
+      // a resumed simulation completes the results of the interrupted one,
+      // with the seed of its checkpoint unless one is given
+      const auto checkpoint_path =
+        fs::path { output_path } / simulation_path.filename() /
+        "checkpoint.bin";
+      const auto resumed = resume && fs::exists(checkpoint_path);
+      const auto parameters = simulator::Parameters::from_json(
+        parameters_data,
+        resumed && !seed.has_value()
+          ? std::optional(
+              simulator::Checkpoint::load_header(checkpoint_path).seed)
+          : seed);
 
       const auto environment =
-        simulator::Environment::from_geojson(environment_data);
+        simulator::Environment::load(simulation_path).reorder(ordering);
+
+      // the binary results are streamed to disk while the simulation runs
+      const auto recorder = format == "binary"
+        ? std::shared_ptr<simulator::output::Sink>(
+            simulator::output::make_results_writer(
+              fs::path { output_path } / simulation_path.filename() /
+                "results.bin",
+              output_mode, every, parameters, resumed))
+        : simulator::output::make_sink(output_mode, every, cohort, parameters);
+      // the history is kept by its sink and written once the run is over
+      const auto history =
+        std::dynamic_pointer_cast<simulator::output::HistorySink>(recorder);
+      const auto sink =
+        pipelined(simulator::output::renumbered(recorder, environment));
 
       futures.emplace_back(std::async(
         std::launch::async,
-        [environment, parameters, &progress_bars, simulation_path,
-         output_path] {
+        [environment, parameters, &progress_bars, &slots, simulation_path,
+         output_path, sink, history, format, execution, pool,
+         checkpoint_path, checkpoint_every, resumed] {
+          // the slot is given back even when the simulation throws
+          slots.acquire();
+          const auto release = [](std::counting_semaphore<>* slots) {
+            slots->release();
+          };
+          const auto slot =
+            std::unique_ptr<std::counting_semaphore<>, decltype(release)>(
+              &slots, release);
+
           auto simulation = simulator::Simulation(
             std::make_shared<simulator::Environment>(environment),
-            std::make_shared<simulator::Parameters>(parameters));
+            std::make_shared<simulator::Parameters>(parameters), pool, sink, 1,
+            execution);
 
           std::string agents_in_states_text = " [Humans{S:" +
             std::to_string(parameters.human_initial_susceptible) +
@@ -106,7 +304,12 @@ auto main(int argc, char* argv[]) -> int {
 
           auto i = progress_bars.push_back(*bar);
 
-          simulation.prepare();
+          simulation.checkpoint(checkpoint_path, checkpoint_every);
+          if (resumed) {
+            simulation.resume(checkpoint_path);
+          } else {
+            simulation.prepare();
+          }
           std::optional<simulator::State const*> state;
           while ((state = simulation.iterate()).has_value()) {
             const auto [actual, total] = state.value()->progress;
@@ -141,16 +344,24 @@ auto main(int argc, char* argv[]) -> int {
             indicators::option::ForegroundColor { indicators::Color::yellow });
 
           // get the simulation results and save them
-          const auto& results = simulation.get_states();
-          nlohmann::json json_results = results;
+          if (format == "json") {
+            const auto& results = simulation.get_states();
+            nlohmann::json json_results = results;
 
-          auto output_path_simulation =
-            output_path / simulation_path.filename() / "results.json";
+            auto output_path_simulation =
+              output_path / simulation_path.filename() / "results.json";
 
-          fs::create_directories(output_path_simulation.parent_path());
-          std::ofstream output_file(output_path_simulation);
-          output_file << json_results.dump(2);
-          output_file.close();
+            fs::create_directories(output_path_simulation.parent_path());
+            std::ofstream output_file(output_path_simulation);
+            output_file << json_results.dump(2);
+            output_file.close();
+
+            if (history) {
+              std::ofstream(output_path / simulation_path.filename() /
+                            "history.json")
+                << history->to_json().dump();
+            }
+          }
 
           simulation_state = "[completed] ";
           progress_bars[i].set_option(indicators::option::PrefixText {
@@ -163,6 +374,10 @@ auto main(int argc, char* argv[]) -> int {
     for (auto& fut : futures) {
       fut.wait();
     }
+    // a simulation that threw reports it once every simulation is done
+    for (auto& fut : futures) {
+      fut.get();
+    }
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
     std::exit(EXIT_FAILURE);
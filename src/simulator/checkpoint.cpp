@@ -0,0 +1,156 @@
+#include <simulator/checkpoint.hpp>
+
+#include <array>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace simulator {
+  namespace {
+    // columns are padded so that every column of the file is aligned
+    constexpr auto pad(std::size_t size) noexcept -> std::size_t {
+      return (size + 7) & ~std::size_t { 7 };
+    }
+
+    constexpr auto compartments = std::size_t { 7 };
+
+    auto read_header(std::ifstream& file, const std::filesystem::path& path)
+      -> Checkpoint::Header {
+      if (!file) {
+        throw std::runtime_error("cannot open checkpoint file: " +
+                                 path.string());
+      }
+
+      auto header = Checkpoint::Header {};
+      file.read(reinterpret_cast<char*>(&header), sizeof(header));
+      if (!file || header.magic != Checkpoint::magic ||
+          header.version != Checkpoint::version) {
+        throw std::runtime_error("not a checkpoint file: " + path.string());
+      }
+      return header;
+    }
+  } // namespace
+
+  auto Checkpoint::save(const std::filesystem::path& path) const -> void {
+    // written aside and renamed, so an interrupted save keeps the previous
+    // checkpoint
+    auto temporary = path;
+    temporary += ".tmp";
+
+    {
+      std::filesystem::create_directories(path.parent_path());
+      auto file = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+      if (!file) {
+        throw std::runtime_error("cannot open checkpoint file: " +
+                                 temporary.string());
+      }
+
+      const auto write = [&file](const auto& column) {
+        const auto bytes = column.size() * sizeof(*column.data());
+        const auto zeros = std::array<char, 8> {};
+        file.write(reinterpret_cast<const char*>(column.data()),
+                   static_cast<std::streamsize>(bytes));
+        file.write(zeros.data(),
+                   static_cast<std::streamsize>(pad(bytes) - bytes));
+      };
+      const auto write_population = [this, write](const auto& population) {
+        write(population.states);
+        write(population.positions);
+        write(population.counters);
+        if (header.sorted != 0) {
+          write(population.ids);
+        }
+      };
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      write_population(humans);
+      write_population(mosquitos);
+      write(counts);
+      for (const auto& replica : states) {
+        write(replica);
+      }
+      if (!file.flush()) {
+        throw std::runtime_error("cannot write checkpoint file: " +
+                                 temporary.string());
+      }
+    }
+
+    std::filesystem::rename(temporary, path);
+  }
+
+  auto Checkpoint::load(const std::filesystem::path& path) -> Checkpoint {
+    auto file = std::ifstream(path, std::ios::binary);
+    auto checkpoint = Checkpoint {};
+    checkpoint.header = read_header(file, path);
+    const auto& header = checkpoint.header;
+
+    const auto read = [&file](auto& column, std::size_t size) {
+      column.resize(size);
+      const auto bytes = size * sizeof(*column.data());
+      auto padding = std::array<char, 8> {};
+      file.read(reinterpret_cast<char*>(column.data()),
+                static_cast<std::streamsize>(bytes));
+      file.read(padding.data(),
+                static_cast<std::streamsize>(pad(bytes) - bytes));
+    };
+    const auto read_population = [&header, read](auto& population,
+                                                  std::size_t size) {
+      read(population.states, size);
+      read(population.positions, size);
+      read(population.counters, size);
+      if (header.sorted != 0) {
+        read(population.ids, size);
+      }
+      population.changes.assign(size, 0);
+      population.next_states.resize(size);
+    };
+
+    read_population(checkpoint.humans, header.humans);
+    read_population(checkpoint.mosquitos, header.mosquitos);
+    read(checkpoint.counts, header.replicas * compartments);
+    checkpoint.states.resize(header.replicas);
+    for (auto& replica : checkpoint.states) {
+      read(replica, header.iteration);
+    }
+    if (!file) {
+      throw std::runtime_error("truncated checkpoint file: " + path.string());
+    }
+
+    return checkpoint;
+  }
+
+  auto Checkpoint::load_header(const std::filesystem::path& path) -> Header {
+    auto file = std::ifstream(path, std::ios::binary);
+    return read_header(file, path);
+  }
+
+  CheckpointWriter::CheckpointWriter(std::filesystem::path path)
+    : path(std::move(path)) {}
+
+  CheckpointWriter::~CheckpointWriter() {
+    // a simulation stopped before its last cycle was not flushed
+    try {
+      flush();
+    } catch (const std::exception& e) {
+      std::cerr << "cannot save the checkpoint: " << e.what() << std::endl;
+    }
+  }
+
+  auto CheckpointWriter::write(std::unique_ptr<const Checkpoint> checkpoint)
+    -> void {
+    flush();
+    pending = std::async(
+      std::launch::async,
+      [path = path, checkpoint = std::shared_ptr<const Checkpoint>(
+                      std::move(checkpoint))] { checkpoint->save(path); });
+  }
+
+  auto CheckpointWriter::flush() -> void {
+    if (pending.valid()) {
+      pending.get();
+    }
+  }
+} // namespace simulator
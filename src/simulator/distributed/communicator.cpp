@@ -0,0 +1,291 @@
+#include <simulator/distributed/communicator.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace simulator::distributed {
+  namespace {
+    // values a rank can sum at once
+    constexpr auto sums = std::size_t { 64 };
+    constexpr auto alignment = std::size_t { 64 };
+
+    constexpr auto aligned(std::size_t bytes) noexcept -> std::size_t {
+      return (bytes + alignment - 1) / alignment * alignment;
+    }
+  } // namespace
+
+  /**
+   * @brief Start of the shared mapping, followed by the segment of each rank
+   *
+   * A segment is the `ranks + 1` offsets of the bytes sent to each rank, the
+   * values to sum and the bytes sent.
+   */
+  struct SharedMemoryCommunicator::Header {
+    std::atomic<std::uint64_t> arrived;
+    std::atomic<std::uint64_t> generation;
+    std::atomic<bool> failed;
+    std::size_t ranks;
+    std::size_t capacity;
+    std::size_t stride;
+  };
+
+  SharedMemoryCommunicator::SharedMemoryCommunicator(
+    Header* header, std::size_t index) noexcept
+    : header(header), index(index) {}
+
+  auto SharedMemoryCommunicator::segment(std::size_t rank) const noexcept
+    -> std::uint64_t* {
+    auto* segments =
+      reinterpret_cast<std::byte*>(header) + aligned(sizeof(Header));
+    return reinterpret_cast<std::uint64_t*>(segments + rank * header->stride);
+  }
+
+  auto SharedMemoryCommunicator::wait() const -> void {
+    // the last rank to arrive opens the next generation, the others spin
+    // until it does or a rank failed
+    const auto generation = header->generation.load(std::memory_order_acquire);
+    if (header->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+        header->ranks) {
+      header->arrived.store(0, std::memory_order_relaxed);
+      header->generation.fetch_add(1, std::memory_order_release);
+      return;
+    }
+
+    for (std::size_t spins = 0;
+         header->generation.load(std::memory_order_acquire) == generation;
+         spins++) {
+      if (header->failed.load(std::memory_order_relaxed)) {
+        throw std::runtime_error("another rank failed");
+      }
+      if (spins < 1024) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+  }
+
+  auto SharedMemoryCommunicator::run(
+    std::size_t ranks, std::size_t capacity,
+    const std::function<void(std::shared_ptr<Communicator>)>& rank) -> void {
+    ranks = std::max(ranks, 1UL);
+    const auto stride =
+      aligned((ranks + 1 + sums) * sizeof(std::uint64_t) + capacity);
+    const auto bytes = aligned(sizeof(Header)) + ranks * stride;
+
+    auto* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(),
+                              "cannot map the shared memory");
+    }
+    auto* header =
+      new (mapping) Header { 0, 0, false, ranks, capacity, stride };
+
+    // whatever is buffered would be written once per process
+    std::cout.flush();
+    std::fflush(nullptr);
+
+    const auto parent = getpid();
+    auto children = std::vector<pid_t>();
+    auto error = std::exception_ptr();
+    try {
+      for (std::size_t r = 1; r < ranks; r++) {
+        const auto child = fork();
+        if (child < 0) {
+          throw std::system_error(errno, std::generic_category(),
+                                  "cannot fork rank " + std::to_string(r));
+        }
+        if (child == 0) {
+          // the ranks do not outlive rank 0
+          prctl(PR_SET_PDEATHSIG, SIGKILL);
+          if (getppid() != parent) {
+            _exit(EXIT_FAILURE);
+          }
+
+          auto status = EXIT_SUCCESS;
+          try {
+            rank(std::shared_ptr<Communicator>(
+              new SharedMemoryCommunicator(header, r)));
+          } catch (const std::exception& e) {
+            header->failed.store(true, std::memory_order_relaxed);
+            std::fprintf(stderr, "rank %zu: %s\n", r, e.what());
+            status = EXIT_FAILURE;
+          }
+          std::fflush(nullptr);
+          _exit(status);
+        }
+        children.push_back(child);
+      }
+
+      rank(std::shared_ptr<Communicator>(
+        new SharedMemoryCommunicator(header, 0)));
+    } catch (...) {
+      header->failed.store(true, std::memory_order_relaxed);
+      error = std::current_exception();
+    }
+
+    auto failed = std::size_t { 0 };
+    for (const auto child : children) {
+      auto status = 0;
+      if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) ||
+          WEXITSTATUS(status) != EXIT_SUCCESS) {
+        failed++;
+      }
+    }
+    munmap(mapping, bytes);
+
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    if (failed != 0) {
+      throw std::runtime_error(std::to_string(failed) + " ranks failed");
+    }
+  }
+
+  auto SharedMemoryCommunicator::rank() const noexcept -> std::size_t {
+    return index;
+  }
+
+  auto SharedMemoryCommunicator::size() const noexcept -> std::size_t {
+    return header->ranks;
+  }
+
+  auto SharedMemoryCommunicator::exchange(
+    const std::vector<std::vector<std::byte>>& outgoing)
+    -> std::vector<std::byte> {
+    const auto ranks = header->ranks;
+    auto* offsets = segment(index);
+    auto* bytes = reinterpret_cast<std::byte*>(offsets + ranks + 1 + sums);
+
+    offsets[0] = 0;
+    for (std::size_t r = 0; r < ranks; r++) {
+      const auto sent = r < outgoing.size()
+        ? std::span<const std::byte>(outgoing[r])
+        : std::span<const std::byte>();
+      if (offsets[r] + sent.size() > header->capacity) {
+        header->failed.store(true, std::memory_order_relaxed);
+        throw std::length_error("exchange over the capacity of " +
+                                std::to_string(header->capacity) + " bytes");
+      }
+      std::memcpy(bytes + offsets[r], sent.data(), sent.size());
+      offsets[r + 1] = offsets[r] + sent.size();
+    }
+    wait();
+
+    auto received = std::vector<std::byte>();
+    for (std::size_t r = 0; r < ranks; r++) {
+      const auto* from = segment(r);
+      const auto* sent = reinterpret_cast<const std::byte*>(from + ranks + 1 +
+                                                            sums);
+      received.insert(std::end(received), sent + from[index],
+                      sent + from[index + 1]);
+    }
+    // the segments are only written again once every rank read them
+    wait();
+    return received;
+  }
+
+  auto SharedMemoryCommunicator::sum(std::span<std::uint64_t> values)
+    -> void {
+    if (values.size() > sums) {
+      header->failed.store(true, std::memory_order_relaxed);
+      throw std::length_error("cannot sum more than " + std::to_string(sums) +
+                              " values");
+    }
+
+    const auto ranks = header->ranks;
+    std::copy(std::begin(values), std::end(values),
+              segment(index) + ranks + 1);
+    wait();
+
+    std::fill(std::begin(values), std::end(values), 0UL);
+    for (std::size_t r = 0; r < ranks; r++) {
+      const auto* from = segment(r) + ranks + 1;
+      for (std::size_t k = 0; k < values.size(); k++) {
+        values[k] += from[k];
+      }
+    }
+    wait();
+  }
+
+  auto SharedMemoryCommunicator::barrier() -> void {
+    wait();
+  }
+
+#ifdef SIMULATOR_MPI
+  MpiCommunicator::MpiCommunicator(MPI_Comm communicator) noexcept
+    : communicator(communicator) {}
+
+  auto MpiCommunicator::rank() const noexcept -> std::size_t {
+    auto rank = 0;
+    MPI_Comm_rank(communicator, &rank);
+    return static_cast<std::size_t>(rank);
+  }
+
+  auto MpiCommunicator::size() const noexcept -> std::size_t {
+    auto size = 0;
+    MPI_Comm_size(communicator, &size);
+    return static_cast<std::size_t>(size);
+  }
+
+  auto MpiCommunicator::exchange(
+    const std::vector<std::vector<std::byte>>& outgoing)
+    -> std::vector<std::byte> {
+    const auto ranks = size();
+    auto sent = std::vector<std::byte>();
+    auto send_counts = std::vector<int>(ranks);
+    auto send_offsets = std::vector<int>(ranks);
+    for (std::size_t r = 0; r < ranks && r < outgoing.size(); r++) {
+      send_offsets[r] = static_cast<int>(sent.size());
+      send_counts[r] = static_cast<int>(outgoing[r].size());
+      sent.insert(std::end(sent), std::begin(outgoing[r]),
+                  std::end(outgoing[r]));
+    }
+
+    auto receive_counts = std::vector<int>(ranks);
+    auto receive_offsets = std::vector<int>(ranks);
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, receive_counts.data(), 1,
+                 MPI_INT, communicator);
+    auto received_size = 0;
+    for (std::size_t r = 0; r < ranks; r++) {
+      receive_offsets[r] = received_size;
+      received_size += receive_counts[r];
+    }
+
+    auto received = std::vector<std::byte>(received_size);
+    MPI_Alltoallv(sent.data(), send_counts.data(), send_offsets.data(),
+                  MPI_BYTE, received.data(), receive_counts.data(),
+                  receive_offsets.data(), MPI_BYTE, communicator);
+    return received;
+  }
+
+  auto MpiCommunicator::sum(std::span<std::uint64_t> values) -> void {
+    MPI_Allreduce(MPI_IN_PLACE, values.data(), static_cast<int>(values.size()),
+                  MPI_UINT64_T, MPI_SUM, communicator);
+  }
+
+  auto MpiCommunicator::barrier() -> void {
+    MPI_Barrier(communicator);
+  }
+#endif
+} // namespace simulator::distributed
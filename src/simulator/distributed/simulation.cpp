@@ -0,0 +1,362 @@
+#include <simulator/distributed/simulation.hpp>
+#include <simulator/rules.hpp>
+#include <simulator/util/random.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <ranges>
+#include <utility>
+
+namespace simulator::distributed {
+  namespace {
+    /**
+     * @brief An agent sent to the rank owning its new position
+     */
+    template <typename Agent>
+    struct Migrant {
+      std::uint32_t id;
+      std::uint32_t position;
+      std::uint32_t counter;
+      typename Agent::State state;
+    };
+
+    template <typename Agent>
+    auto append(Population<Agent>& population, const Migrant<Agent>& migrant)
+      -> void {
+      population.states.push_back(migrant.state);
+      population.positions.push_back(migrant.position);
+      population.counters.push_back(migrant.counter);
+      population.changes.push_back(Population<Agent>::Unchanged);
+      population.next_states.push_back(migrant.state);
+      population.ids.push_back(migrant.id);
+    }
+
+    /**
+     * @brief Keep the first `size` agents of a population
+     */
+    template <typename Agent>
+    auto truncate(Population<Agent>& population, std::size_t size) -> void {
+      population.states.resize(size);
+      population.positions.resize(size);
+      population.counters.resize(size);
+      population.changes.resize(size);
+      population.next_states.resize(size);
+      population.ids.resize(size);
+    }
+  } // namespace
+
+  auto Partition::balanced(const Environment& environment, std::size_t ranks)
+    -> Partition {
+    ranks = std::max(ranks, 1UL);
+    const auto size = environment.size;
+    // nodes and edges before a node, increasing with the node
+    const auto weight = [&environment](std::size_t node) noexcept {
+      return node + environment.offsets[node];
+    };
+
+    auto partition = Partition { std::vector<std::size_t>(ranks + 1) };
+    for (std::size_t r = 1; r < ranks; r++) {
+      const auto target = weight(size) * r / ranks;
+      partition.firsts[r] = *std::ranges::partition_point(
+        std::views::iota(partition.firsts[r - 1], size),
+        [weight, target](auto node) { return weight(node) < target; });
+    }
+    partition.firsts[ranks] = size;
+    return partition;
+  }
+
+  auto Partition::owner(std::size_t node) const noexcept -> std::size_t {
+    return static_cast<std::size_t>(
+      std::upper_bound(std::begin(firsts), std::end(firsts), node) -
+      std::begin(firsts) - 1);
+  }
+
+  Simulation::Simulation(std::shared_ptr<const Environment> environment,
+                         std::shared_ptr<const Parameters> parameters,
+                         std::shared_ptr<Communicator> communicator)
+    : parameters(std::move(parameters)), communicator(std::move(communicator)),
+      partition(Partition::balanced(*environment, this->communicator->size())),
+      seed(this->parameters->seed), nodes(environment->size),
+      first(partition.firsts[this->communicator->rank()]),
+      last(partition.firsts[this->communicator->rank() + 1]),
+      humans(std::make_unique<Population<Human>>(0)),
+      mosquitos(std::make_unique<Population<Mosquito>>(0)) {
+    states.reserve(this->parameters->cycles);
+
+    // the edges of the owned nodes, rebased to the first of them
+    const auto base = environment->offsets[first];
+    offsets.reserve(last - first + 1);
+    for (auto node = first; node <= last; node++) {
+      offsets.push_back(environment->offsets[node] - base);
+    }
+    neighbours.assign(std::begin(environment->neighbours) + base,
+                      std::begin(environment->neighbours) +
+                        environment->offsets[last]);
+
+    inputs.reserve(last - first);
+    for (auto node = first; node < last; node++) {
+      inputs.emplace_back(environment->input(node),
+                          static_cast<std::uint32_t>(node));
+    }
+    std::ranges::sort(inputs);
+  }
+
+  auto Simulation::edges(std::size_t node) const noexcept
+    -> std::span<const std::uint32_t> {
+    const auto* offset = offsets.data() + (node - first);
+    return std::span(neighbours).subspan(offset[0], offset[1] - offset[0]);
+  }
+
+  auto Simulation::capacity(const Parameters& parameters) noexcept
+    -> std::size_t {
+    return sizeof(Migrant<Human>) *
+      (parameters.human_initial_susceptible +
+       parameters.human_initial_exposed + parameters.human_initial_infected +
+       parameters.human_initial_recovered) +
+      sizeof(Migrant<Mosquito>) *
+      (parameters.mosquito_initial_susceptible +
+       parameters.mosquito_initial_infected +
+       parameters.mosquito_initial_recovered);
+  }
+
+  auto Simulation::run() -> void {
+    insertion();
+    for (std::size_t i = 0; i < parameters->cycles; i++) {
+      movement();
+      contact();
+      transition();
+      output();
+    }
+  }
+
+  auto Simulation::insertion() -> void {
+    // every rank draws the position of every agent, as `Simulation` does,
+    // and keeps the ones starting in its nodes
+    const auto insert = [this](auto& population, util::Stream stream,
+                               auto state, std::size_t begin,
+                               std::size_t count) {
+      const auto random_position =
+        util::make_counter_rng(0UL, nodes - 1, seed, stream);
+      for (auto id = begin; id < begin + count; id++) {
+        const auto input =
+          static_cast<std::uint32_t>(random_position(0, id));
+        const auto owned = std::ranges::lower_bound(
+          inputs, input, {}, &std::pair<std::uint32_t, std::uint32_t>::first);
+        if (owned != std::end(inputs) && owned->first == input) {
+          append(population,
+                 { static_cast<std::uint32_t>(id), owned->second, 0, state });
+        }
+      }
+    };
+
+    auto id = std::size_t { 0 };
+    for (const auto& [state, count] :
+         { std::pair { Human::State::Susceptible,
+                       parameters->human_initial_susceptible },
+           std::pair { Human::State::Exposed,
+                       parameters->human_initial_exposed },
+           std::pair { Human::State::Infected,
+                       parameters->human_initial_infected },
+           std::pair { Human::State::Recovered,
+                       parameters->human_initial_recovered } }) {
+      insert(*humans, util::Stream::HumanInsertion, state, id, count);
+      id += count;
+    }
+
+    id = 0;
+    for (const auto& [state, count] :
+         { std::pair { Mosquito::State::Susceptible,
+                       parameters->mosquito_initial_susceptible },
+           std::pair { Mosquito::State::Infected,
+                       parameters->mosquito_initial_infected },
+           std::pair { Mosquito::State::Recovered,
+                       parameters->mosquito_initial_recovered } }) {
+      insert(*mosquitos, util::Stream::MosquitoInsertion, state, id, count);
+      id += count;
+    }
+  }
+
+  template <typename Agent>
+  auto Simulation::migrate(Population<Agent>& population) -> void {
+    // the agents staying are compacted in place, in slot order
+    auto outgoing = std::vector<std::vector<std::byte>>(communicator->size());
+    auto kept = std::size_t { 0 };
+    for (std::size_t slot = 0; slot < population.size(); slot++) {
+      const auto position = population.positions[slot];
+      if (position >= first && position < last) {
+        population.states[kept] = population.states[slot];
+        population.positions[kept] = position;
+        population.counters[kept] = population.counters[slot];
+        population.changes[kept] = population.changes[slot];
+        population.ids[kept] = population.ids[slot];
+        kept++;
+        continue;
+      }
+
+      const auto migrant =
+        Migrant<Agent> { population.ids[slot], position,
+                         population.counters[slot], population.states[slot] };
+      const auto* bytes = reinterpret_cast<const std::byte*>(&migrant);
+      auto& sent = outgoing[partition.owner(position)];
+      sent.insert(std::end(sent), bytes, bytes + sizeof(migrant));
+    }
+    truncate(population, kept);
+
+    const auto received = communicator->exchange(outgoing);
+    for (std::size_t offset = 0; offset < received.size();
+         offset += sizeof(Migrant<Agent>)) {
+      auto migrant = Migrant<Agent> {};
+      std::memcpy(&migrant, received.data() + offset, sizeof(migrant));
+      append(population, migrant);
+    }
+  }
+
+  template <typename Agent>
+  auto Simulation::group(const Population<Agent>& population,
+                         std::vector<std::size_t>& offsets,
+                         std::vector<std::uint32_t>& agents) const -> void {
+    // counting sort by node, the agents of a node stay in slot order
+    offsets.assign(last - first + 1, 0UL);
+    for (const auto position : population.positions) {
+      offsets[position - first + 1]++;
+    }
+    std::partial_sum(std::begin(offsets), std::end(offsets),
+                     std::begin(offsets));
+
+    auto cursors = std::vector<std::size_t>(std::begin(offsets),
+                                            std::end(offsets) - 1);
+    agents.resize(population.size());
+    for (std::size_t slot = 0; slot < population.size(); slot++) {
+      agents[cursors[population.positions[slot] - first]++] =
+        static_cast<std::uint32_t>(slot);
+    }
+  }
+
+  auto Simulation::movement() -> void {
+    const auto move = [this](auto& population, util::Stream stream) {
+      const auto random_position =
+        util::make_counter_rng(0UL, nodes - 1, seed, stream);
+      for (std::size_t slot = 0; slot < population.size(); slot++) {
+        const auto edges = this->edges(population.positions[slot]);
+        population.positions[slot] =
+          edges[random_position(iteration, population.id(slot)) %
+                edges.size()];
+      }
+    };
+
+    move(*humans, util::Stream::HumanMovement);
+    move(*mosquitos, util::Stream::MosquitoMovement);
+
+    // the agents leaving the nodes of this rank are handed over, then the
+    // resident agents are grouped by node for the contact
+    migrate(*humans);
+    migrate(*mosquitos);
+    group(*humans, humans_offsets, humans_in_position);
+    group(*mosquitos, mosquitos_offsets, mosquitos_in_position);
+  }
+
+  auto Simulation::contact() -> void {
+    const auto random_human_probability =
+      util::make_counter_rng(0.0, 1.0, seed, util::Stream::HumanContact);
+    const auto random_mosquito_probability =
+      util::make_counter_rng(0.0, 1.0, seed, util::Stream::MosquitoContact);
+    const auto random_mosquito_mosquito_probability = util::make_counter_rng(
+      0.0, 1.0, seed, util::Stream::MosquitoMosquitoContact);
+
+    // every resident agent is in one of the nodes, so each next state is
+    // written once and the states are swapped afterwards
+    for (std::size_t node = 0; node < last - first; node++) {
+      const auto humans_in_pos =
+        std::span(humans_in_position)
+          .subspan(humans_offsets[node],
+                   humans_offsets[node + 1] - humans_offsets[node]);
+      const auto mosquitos_in_pos =
+        std::span(mosquitos_in_position)
+          .subspan(mosquitos_offsets[node],
+                   mosquitos_offsets[node + 1] - mosquitos_offsets[node]);
+
+      for (const auto human : humans_in_pos) {
+        auto state = humans->states[human];
+        if (state == Human::State::Susceptible &&
+            infected_by(iteration, humans->id(human), mosquitos_in_pos,
+                        *mosquitos, Mosquito::State::Infected,
+                        random_human_probability,
+                        parameters->human_infection_rate)) {
+          state = Human::State::Exposed;
+          exposed++;
+        }
+        humans->next_states[human] = state;
+      }
+
+      for (const auto mosquito : mosquitos_in_pos) {
+        auto state = mosquitos->states[mosquito];
+        if (state == Mosquito::State::Susceptible &&
+            (infected_by(iteration, mosquitos->id(mosquito), humans_in_pos,
+                         *humans, Human::State::Infected,
+                         random_mosquito_probability,
+                         parameters->mosquito_infection_rate) ||
+             infected_by(iteration, mosquitos->id(mosquito), mosquitos_in_pos,
+                         *mosquitos, Mosquito::State::Infected,
+                         random_mosquito_mosquito_probability,
+                         parameters->mosquito_infection_rate))) {
+          state = Mosquito::State::Infected;
+          infected++;
+        }
+        mosquitos->next_states[mosquito] = state;
+      }
+    }
+
+    humans->states.swap(humans->next_states);
+    mosquitos->states.swap(mosquitos->next_states);
+  }
+
+  auto Simulation::transition() -> void {
+    for (std::size_t slot = 0; slot < humans->size(); slot++) {
+      simulator::transition(humans->states[slot], humans->counters[slot],
+                            *parameters);
+    }
+    for (std::size_t slot = 0; slot < mosquitos->size(); slot++) {
+      simulator::transition(mosquitos->states[slot], mosquitos->counters[slot],
+                            *parameters);
+    }
+  }
+
+  auto Simulation::output() -> const State& {
+    ++iteration;
+
+    // the 7 compartments then the incidence, summed over the ranks
+    auto totals = std::array<std::uint64_t, 9> {};
+    for (const auto state : humans->states) {
+      totals[state == Human::State::Susceptible ? 0
+               : state == Human::State::Exposed ? 1
+               : state == Human::State::Infected ? 2
+                                                 : 3]++;
+    }
+    for (const auto state : mosquitos->states) {
+      totals[state == Mosquito::State::Susceptible ? 4
+               : state == Mosquito::State::Infected ? 5
+                                                    : 6]++;
+    }
+    totals[7] = exposed;
+    totals[8] = infected;
+    communicator->sum(totals);
+    exposed = 0;
+    infected = 0;
+
+    states.push_back({
+      { iteration, parameters->cycles },
+      { totals[0], totals[1], totals[2], totals[3] },
+      { totals[4], totals[5], totals[6] },
+      { totals[7], totals[8] },
+      {},
+      {},
+    });
+    return states.back();
+  }
+
+  auto Simulation::get_states() const noexcept -> const std::vector<State>& {
+    return states;
+  }
+} // namespace simulator::distributed
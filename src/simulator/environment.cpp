@@ -1,12 +1,28 @@
 #include <simulator/environment.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstddef>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <numeric>
 #include <optional>
 #include <ranges>
 #include <set>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <system_error>
 #include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <nlohmann/json.hpp>
 
@@ -14,10 +30,188 @@ namespace simulator {
 
   using json = nlohmann::json;
 
+  namespace {
+    constexpr auto magic =
+      std::array<char, 8> { 'S', 'I', 'M', 'E', 'N', 'V', '0', '1' };
+    constexpr auto version = std::uint32_t { 1 };
+
+    /**
+     * @brief Header of a compiled environment, followed by the points, the
+     * offsets and the neighbours, each padded to 8 bytes
+     */
+    struct Header {
+      std::array<char, 8> magic;
+      std::uint32_t version;
+      std::uint32_t reserved;
+      std::uint64_t hash;
+      std::uint64_t source_size;
+      std::int64_t source_time;
+      std::uint64_t nodes;
+      std::uint64_t edges;
+    };
+
+    struct Graph {
+      std::vector<Environment::Point> points;
+      std::vector<std::uint32_t> offsets;
+      std::vector<std::uint32_t> neighbours;
+      std::vector<std::uint32_t> inputs;
+      std::vector<std::uint32_t> nodes;
+    };
+
+    constexpr auto pad(std::size_t size) noexcept -> std::size_t {
+      return (size + 7) & ~std::size_t { 7 };
+    }
+
+    auto fnv1a(std::string_view data) noexcept -> std::uint64_t {
+      auto hash = std::uint64_t { 0xcbf29ce484222325 };
+      for (const auto c : data) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+      }
+      return hash;
+    }
+
+    auto source_time(const std::filesystem::path& source) -> std::int64_t {
+      return std::filesystem::last_write_time(source)
+        .time_since_epoch()
+        .count();
+    }
+
+    auto read(const std::filesystem::path& source) -> std::string {
+      auto file = std::ifstream { source };
+      if (!file) {
+        throw std::runtime_error("cannot open environment file: " +
+                                 source.string());
+      }
+      return { std::istreambuf_iterator<char> { file },
+               std::istreambuf_iterator<char> {} };
+    }
+
+    /**
+     * @brief Reverse Cuthill-McKee order of the nodes, each component is
+     * visited breadth first from its lowest degree node, the neighbours by
+     * ascending degree
+     */
+    auto cuthill_mckee(const Environment& environment)
+      -> std::vector<std::uint32_t> {
+      const auto degree = [&environment](auto node) {
+        return environment.edges(node).size();
+      };
+      const auto by_degree = [&degree](auto a, auto b) {
+        return degree(a) < degree(b);
+      };
+
+      auto starts = std::vector<std::uint32_t>(environment.size);
+      std::iota(std::begin(starts), std::end(starts), 0U);
+      std::stable_sort(std::begin(starts), std::end(starts), by_degree);
+
+      auto visited = std::vector<bool>(environment.size);
+      auto order = std::vector<std::uint32_t> {};
+      order.reserve(environment.size);
+      auto neighbours = std::vector<std::uint32_t> {};
+      for (const auto start : starts) {
+        if (visited[start]) {
+          continue;
+        }
+        visited[start] = true;
+        order.push_back(start);
+
+        for (auto head = order.size() - 1; head < order.size(); head++) {
+          neighbours.clear();
+          for (const auto neighbour : environment.edges(order[head])) {
+            if (!visited[neighbour]) {
+              visited[neighbour] = true;
+              neighbours.push_back(neighbour);
+            }
+          }
+          std::stable_sort(std::begin(neighbours), std::end(neighbours),
+                           by_degree);
+          order.insert(std::end(order), std::begin(neighbours),
+                       std::end(neighbours));
+        }
+      }
+
+      std::reverse(std::begin(order), std::end(order));
+      return order;
+    }
+
+    /**
+     * @brief Distance along the Hilbert curve filling a 2^16 x 2^16 grid
+     */
+    constexpr auto hilbert_index(std::uint32_t x, std::uint32_t y) noexcept
+      -> std::uint64_t {
+      constexpr auto side = std::uint32_t { 1 } << 16;
+      auto index = std::uint64_t { 0 };
+      for (auto s = side / 2; s > 0; s /= 2) {
+        const auto rx = (x & s) != 0 ? 1U : 0U;
+        const auto ry = (y & s) != 0 ? 1U : 0U;
+        index += std::uint64_t { s } * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+          if (rx == 1) {
+            x = side - 1 - x;
+            y = side - 1 - y;
+          }
+          std::swap(x, y);
+        }
+      }
+      return index;
+    }
+
+    /**
+     * @brief Order of the nodes along a Hilbert curve over their bounding box
+     */
+    auto hilbert(const Environment& environment)
+      -> std::vector<std::uint32_t> {
+      auto low = Environment::Point { 0.0, 0.0 };
+      auto high = Environment::Point { 0.0, 0.0 };
+      if (!environment.points.empty()) {
+        low = high = environment.points.front();
+      }
+      for (const auto& point : environment.points) {
+        for (std::size_t axis = 0; axis < point.size(); axis++) {
+          low[axis] = std::min(low[axis], point[axis]);
+          high[axis] = std::max(high[axis], point[axis]);
+        }
+      }
+      const auto grid = [&low, &high](const auto& point, auto axis) {
+        const auto extent = high[axis] - low[axis];
+        return extent > 0.0 ? static_cast<std::uint32_t>(
+                                (point[axis] - low[axis]) / extent * 65535.0)
+                            : 0U;
+      };
+
+      auto indices = std::vector<std::uint64_t>(environment.size);
+      for (std::size_t node = 0; node < environment.size; node++) {
+        const auto& point = environment.points[node];
+        indices[node] = hilbert_index(grid(point, 0), grid(point, 1));
+      }
+
+      auto order = std::vector<std::uint32_t>(environment.size);
+      std::iota(std::begin(order), std::end(order), 0U);
+      std::stable_sort(std::begin(order), std::end(order),
+                       [&indices](auto a, auto b) {
+                         return indices[a] < indices[b];
+                       });
+      return order;
+    }
+  } // namespace
+
+  auto parse_ordering(std::string_view ordering) -> Ordering {
+    if (ordering == "input") {
+      return Ordering::Input;
+    }
+    if (ordering == "rcm") {
+      return Ordering::ReverseCuthillMcKee;
+    }
+    if (ordering == "hilbert") {
+      return Ordering::Hilbert;
+    }
+    throw std::invalid_argument("unknown ordering: " + std::string(ordering));
+  }
+
   auto Environment::from_geojson(const std::string_view data) noexcept
     -> Environment {
     std::vector<Point> points;
-    std::vector<std::vector<std::size_t>> edges;
+    std::vector<std::vector<std::uint32_t>> edges;
 
     const auto environment = json::parse(data);
 
@@ -25,13 +219,12 @@ namespace simulator {
       const auto& type = feature["geometry"]["type"].get<std::string>();
       if (type == "Point") {
         const auto& point = feature["geometry"]["coordinates"].get<Point>();
-        const auto& id = feature["id"].get<std::size_t>();
 
         points.emplace_back(point);
         edges.emplace_back();
       } else if (type == "LineString") {
-        const auto src = feature["src"].get<std::size_t>();
-        const auto tgt = feature["tgt"].get<std::size_t>();
+        const auto src = feature["src"].get<std::uint32_t>();
+        const auto tgt = feature["tgt"].get<std::uint32_t>();
 
         // NOTE: Points ids begin at 1, but point indices begin at 0
         edges[src - 1].push_back(tgt - 1);
@@ -39,6 +232,250 @@ namespace simulator {
       }
     }
 
-    return { points, edges, points.size() };
+    auto graph = std::make_shared<Graph>();
+    graph->points = std::move(points);
+    graph->offsets.reserve(edges.size() + 1);
+    graph->offsets.push_back(0);
+    for (const auto& node : edges) {
+      graph->neighbours.insert(graph->neighbours.end(), node.begin(),
+                               node.end());
+      graph->offsets.push_back(
+        static_cast<std::uint32_t>(graph->neighbours.size()));
+    }
+
+    return { graph->points, graph->offsets, graph->neighbours,
+             graph->points.size(), fnv1a(data), graph, {}, {} };
+  }
+
+  auto Environment::from_binary(const std::filesystem::path& path)
+    -> Environment {
+    const auto descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      throw std::system_error(errno, std::generic_category(), path.string());
+    }
+
+    struct stat status {};
+    ::fstat(descriptor, &status);
+    const auto size = static_cast<std::size_t>(status.st_size);
+    if (size < sizeof(Header)) {
+      ::close(descriptor);
+      throw std::runtime_error("truncated environment file: " + path.string());
+    }
+
+    auto* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), path.string());
+    }
+    const auto storage = std::shared_ptr<const void>(
+      mapping, [size](const void* mapping) {
+        ::munmap(const_cast<void*>(mapping), size);
+      });
+
+    const auto* data = static_cast<const std::byte*>(mapping);
+    const auto& header = *reinterpret_cast<const Header*>(data);
+    const auto points = sizeof(Header);
+    const auto offsets = points + pad(header.nodes * sizeof(Point));
+    const auto neighbours =
+      offsets + pad((header.nodes + 1) * sizeof(std::uint32_t));
+    if (header.magic != magic || header.version != version ||
+        size < neighbours + header.edges * sizeof(std::uint32_t)) {
+      throw std::runtime_error("not an environment file: " + path.string());
+    }
+
+    auto environment = Environment {
+      { reinterpret_cast<const Point*>(data + points), header.nodes },
+      { reinterpret_cast<const std::uint32_t*>(data + offsets),
+        header.nodes + 1 },
+      { reinterpret_cast<const std::uint32_t*>(data + neighbours),
+        header.edges },
+      header.nodes,
+      header.hash,
+      storage,
+      {},
+      {},
+    };
+
+    // the spans are only handed out over a well formed graph
+    const auto& csr = environment.offsets;
+    if (csr.front() != 0 || csr.back() != header.edges ||
+        std::ranges::adjacent_find(csr, std::greater<>()) != std::end(csr) ||
+        std::ranges::any_of(environment.neighbours, [&header](auto node) {
+          return node >= header.nodes;
+        })) {
+      throw std::runtime_error("corrupt environment file: " + path.string());
+    }
+    return environment;
+  }
+
+  auto Environment::to_binary(const std::filesystem::path& path,
+                              const std::filesystem::path& source) const
+    -> void {
+    // written aside under a unique name and renamed, so concurrent readers
+    // never map a partial file and concurrent writers never interleave
+    auto name = path.string() + ".XXXXXX";
+    const auto descriptor = ::mkstemp(name.data());
+    if (descriptor < 0) {
+      throw std::system_error(errno, std::generic_category(), name);
+    }
+    ::fchmod(descriptor, 0644);
+    ::close(descriptor);
+    const auto temporary = std::filesystem::path(name);
+
+    try {
+      auto file = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+      if (!file) {
+        throw std::runtime_error("cannot open environment file: " +
+                                 temporary.string());
+      }
+
+      const auto header = Header {
+        magic,
+        version,
+        0,
+        hash,
+        static_cast<std::uint64_t>(std::filesystem::file_size(source)),
+        source_time(source),
+        size,
+        neighbours.size(),
+      };
+      const auto write = [&file](const auto& column) {
+        const auto bytes = column.size() * sizeof(*column.data());
+        const auto zeros = std::array<char, 8> {};
+        file.write(reinterpret_cast<const char*>(column.data()),
+                   static_cast<std::streamsize>(bytes));
+        file.write(zeros.data(),
+                   static_cast<std::streamsize>(pad(bytes) - bytes));
+      };
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      write(points);
+      write(offsets);
+      write(neighbours);
+      if (!file.flush()) {
+        throw std::runtime_error("cannot write environment file: " +
+                                 temporary.string());
+      }
+      file.close();
+
+      std::filesystem::rename(temporary, path);
+    } catch (...) {
+      auto error = std::error_code();
+      std::filesystem::remove(temporary, error);
+      throw;
+    }
+  }
+
+  auto Environment::load(const std::filesystem::path& directory)
+    -> Environment {
+    const auto source = directory / "environment.json";
+    const auto cache = directory / "environment.bin";
+
+    // a cache failing to map, e.g. a corrupt one, is rebuilt from the source
+    const auto mapped = [&cache]() -> std::optional<Environment> {
+      try {
+        return from_binary(cache);
+      } catch (const std::exception& e) {
+        std::cerr << "rebuilding the environment cache: " << e.what()
+                  << std::endl;
+        return std::nullopt;
+      }
+    };
+
+    auto data = std::optional<std::string>();
+    if (std::filesystem::exists(cache)) {
+      if (!std::filesystem::exists(source)) {
+        return from_binary(cache);
+      }
+
+      // the fields of a short header, or of another format, mean nothing
+      auto header = Header {};
+      auto file = std::ifstream { cache, std::ios::binary };
+      file.read(reinterpret_cast<char*>(&header), sizeof(header));
+      const auto current =
+        file && header.magic == magic && header.version == version;
+
+      if (current &&
+          header.source_size == std::filesystem::file_size(source)) {
+        // the times only vouch for the cache when they match and the source
+        // was not written within the clock resolution of the cache, a copied
+        // or touched source, or one edited right after the cache was
+        // written, is checked against the hash of its contents
+        const auto settled =
+          std::filesystem::last_write_time(cache) -
+            std::filesystem::last_write_time(source) >=
+          std::chrono::seconds(2);
+        if (header.source_time == source_time(source) && settled) {
+          if (auto environment = mapped()) {
+            return std::move(*environment);
+          }
+        }
+
+        data = read(source);
+        auto environment =
+          fnv1a(*data) == header.hash ? mapped() : std::nullopt;
+        if (environment) {
+          if (header.source_time != source_time(source)) {
+            try {
+              environment->to_binary(cache, source);
+            } catch (const std::exception& e) {
+              std::cerr << "cannot cache the environment: " << e.what()
+                        << std::endl;
+            }
+          }
+          return std::move(*environment);
+        }
+      }
+    }
+
+    if (!data) {
+      data = read(source);
+    }
+    const auto environment = from_geojson(*data);
+
+    // a read only input directory only costs the parsing on every run
+    try {
+      environment.to_binary(cache, source);
+    } catch (const std::exception& e) {
+      std::cerr << "cannot cache the environment: " << e.what() << std::endl;
+    }
+
+    return environment;
+  }
+
+  auto Environment::reorder(Ordering ordering) const -> Environment {
+    if (ordering == Ordering::Input) {
+      return *this;
+    }
+
+    // `order[k]` is the node renumbered `k`
+    const auto order = ordering == Ordering::Hilbert ? hilbert(*this)
+                                                     : cuthill_mckee(*this);
+    auto renumbered = std::vector<std::uint32_t>(size);
+    for (std::size_t k = 0; k < size; k++) {
+      renumbered[order[k]] = static_cast<std::uint32_t>(k);
+    }
+
+    auto graph = std::make_shared<Graph>();
+    graph->points.reserve(size);
+    graph->offsets.reserve(size + 1);
+    graph->offsets.push_back(0);
+    graph->neighbours.reserve(neighbours.size());
+    graph->inputs.resize(size);
+    graph->nodes.resize(size);
+    for (std::size_t k = 0; k < size; k++) {
+      const auto node = order[k];
+      graph->points.push_back(points[node]);
+      for (const auto neighbour : edges(node)) {
+        graph->neighbours.push_back(renumbered[neighbour]);
+      }
+      graph->offsets.push_back(
+        static_cast<std::uint32_t>(graph->neighbours.size()));
+      graph->inputs[k] = input(node);
+      graph->nodes[input(node)] = static_cast<std::uint32_t>(k);
+    }
+
+    return { graph->points, graph->offsets, graph->neighbours, size, hash,
+             graph,         graph->inputs,  graph->nodes };
   }
 } // namespace simulator
@@ -0,0 +1,35 @@
+#include <simulator/execution.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace simulator {
+  auto parse_placement(std::string_view placement) -> Placement {
+    if (placement == "sync") {
+      return Placement::Sync;
+    }
+    if (placement == "cpu") {
+      return Placement::Cpu;
+    }
+    if (placement == "gpu") {
+      return Placement::Gpu;
+    }
+    throw std::invalid_argument("unknown placement: " +
+                                std::string(placement));
+  }
+
+  auto Execution::from_strings(std::string_view placement,
+                               std::optional<std::string_view> insertion,
+                               std::optional<std::string_view> movement,
+                               std::optional<std::string_view> contact,
+                               std::optional<std::string_view> transition)
+    -> Execution {
+    const auto all = parse_placement(placement);
+    const auto phase = [all](std::optional<std::string_view> placement) {
+      return placement ? parse_placement(*placement) : all;
+    };
+
+    return { phase(insertion), phase(movement), phase(contact),
+             phase(transition) };
+  }
+} // namespace simulator
@@ -0,0 +1,29 @@
+#include <simulator/frontier.hpp>
+
+#include <numeric>
+
+namespace simulator {
+  Frontier::Frontier(std::size_t cells)
+    : counts(cells), cells(cells), active(cells) {
+    std::iota(std::begin(this->cells), std::end(this->cells), 0UL);
+  }
+
+  auto Frontier::clear() noexcept -> void {
+    std::fill(std::execution::par_unseq, std::begin(counts), std::end(counts),
+              std::array<std::uint32_t, None> {});
+  }
+
+  auto Frontier::update() noexcept -> std::span<const std::size_t> {
+    const auto end = std::copy_if(
+      std::execution::par_unseq, std::begin(cells), std::end(cells),
+      std::begin(active), [this](auto cell) noexcept {
+        const auto& count = counts[cell];
+        return (count[SusceptibleHumans] != 0 &&
+                count[InfectiousMosquitos] != 0) ||
+          (count[SusceptibleMosquitos] != 0 &&
+           (count[InfectiousHumans] != 0 || count[InfectiousMosquitos] != 0));
+      });
+    size = static_cast<std::size_t>(end - std::begin(active));
+    return { active.data(), size };
+  }
+} // namespace simulator
@@ -1,17 +1,71 @@
 #include <simulator/monte_carlo.hpp>
 #include <simulator/simulation.hpp>
+#include <simulator/util/random.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include <exec/on.hpp>
+#include <exec/static_thread_pool.hpp>
+#include <stdexec/execution.hpp>
 
 namespace simulator {
-  MonteCarlo::MonteCarlo(const Environment& environment,
-                         const Parameters& parameters)
-    : environment(environment), parameters(parameters) {}
-
-  auto MonteCarlo::run() const -> void {
-    /*auto simulations_count = parameters.runs;*/
-    /**/
-    /*for (auto i = 0U; i < simulations_count; ++i) {*/
-    /*  auto simulation = Simulation(environment, parameters);*/
-    /*  simulation.run();*/
-    /*}*/
+  MonteCarlo::MonteCarlo(std::shared_ptr<const Environment> environment,
+                         std::string_view parameters,
+                         std::optional<std::uint64_t> seed, std::size_t jobs,
+                         SinkFactory make_sink, Execution execution,
+                         std::size_t threads)
+    : MonteCarlo(std::move(environment), parameters, seed, jobs,
+                 std::move(make_sink), execution,
+                 std::make_shared<exec::static_thread_pool>(
+                   static_cast<std::uint32_t>(threads))) {}
+
+  MonteCarlo::MonteCarlo(std::shared_ptr<const Environment> environment,
+                         std::string_view parameters,
+                         std::optional<std::uint64_t> seed, std::size_t jobs,
+                         SinkFactory make_sink, Execution execution,
+                         std::shared_ptr<exec::static_thread_pool> pool)
+    : environment(std::move(environment)), parameters(parameters),
+      make_sink(std::move(make_sink)), execution(execution),
+      pool(std::move(pool)) {
+    const auto sampled = Parameters::from_json(parameters, seed);
+    this->seed = sampled.seed;
+    runs = std::max(sampled.runs, 1UL);
+    this->jobs = std::clamp(jobs, 1UL, runs);
+  }
+
+  auto MonteCarlo::replica_seed(std::uint64_t seed,
+                                std::size_t replica) noexcept
+    -> std::uint64_t {
+    if (replica == 0) {
+      return seed;
+    }
+
+    const auto random = util::make_counter_rng(
+      std::uint64_t { 0 }, std::numeric_limits<std::uint64_t>::max(), seed,
+      util::Stream::Replicas);
+    return random(0, replica);
+  }
+
+  auto MonteCarlo::run(const ReplicaHandler& done) const -> void {
+    // `jobs` threads drive the replicas, which all run their phases on the
+    // same shared pool so they do not oversubscribe the cores
+    auto drivers = exec::static_thread_pool { static_cast<uint32_t>(jobs) };
+
+    const auto replicate = [this, &done](std::size_t replica) {
+      const auto parameters = std::make_shared<const Parameters>(
+        Parameters::from_json(this->parameters, replica_seed(seed, replica)));
+      auto simulation = Simulation(
+        environment, parameters, pool,
+        make_sink ? make_sink(replica, *parameters) : nullptr, 1, execution);
+      simulation.run();
+
+      done(replica, *parameters, simulation.get_states());
+    };
+
+    stdexec::sync_wait(stdexec::just() |
+                       exec::on(drivers.get_scheduler(),
+                                stdexec::bulk(runs, replicate)));
   }
 } // namespace simulator
@@ -0,0 +1,17 @@
+#include <simulator/occupancy.hpp>
+
+#include <numeric>
+
+namespace simulator {
+  Occupancy::Occupancy(std::size_t cells, std::size_t agents)
+    : counts(cells, 0UL), offsets(cells + 1, 0UL), agents(agents),
+      cursors(cells), ids(agents) {
+    std::iota(std::begin(ids), std::end(ids), 0UL);
+  }
+
+  auto Occupancy::in(std::size_t cell) const noexcept
+    -> std::span<const std::size_t> {
+    return { agents.data() + offsets[cell],
+             agents.data() + offsets[cell + 1] };
+  }
+} // namespace simulator
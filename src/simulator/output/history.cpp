@@ -0,0 +1,35 @@
+#include <simulator/output/history.hpp>
+
+#include <algorithm>
+
+namespace simulator::output {
+  HistorySink::HistorySink(std::size_t interval, bool positions)
+    : humans(std::max(interval, 1UL), positions),
+      mosquitos(std::max(interval, 1UL), positions) {}
+
+  auto HistorySink::record(State& state, const Population<Human>& humans,
+                           const Population<Mosquito>& mosquitos) -> void {
+    this->humans.record(state.progress.first, humans);
+    this->mosquitos.record(state.progress.first, mosquitos);
+  }
+
+  auto HistorySink::humans_at(std::size_t cycle) const -> std::vector<Human> {
+    return humans.at(cycle);
+  }
+
+  auto HistorySink::mosquitos_at(std::size_t cycle) const
+    -> std::vector<Mosquito> {
+    return mosquitos.at(cycle);
+  }
+
+  auto HistorySink::cycles() const noexcept -> std::size_t {
+    return humans.cycles();
+  }
+
+  auto HistorySink::to_json() const -> nlohmann::json {
+    return nlohmann::json {
+      { "humans", humans.to_json() },
+      { "mosquitos", mosquitos.to_json() },
+    };
+  }
+} // namespace simulator::output
@@ -0,0 +1,107 @@
+#include <simulator/output/pipeline.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace simulator::output {
+  namespace {
+    /**
+     * @brief Copy the columns read by the sinks, reusing the memory of `to`
+     */
+    template <typename Agent>
+    auto copy(Population<Agent>& to, const Population<Agent>& from) -> void {
+      to.states = from.states;
+      to.positions = from.positions;
+      to.counters = from.counters;
+      to.changes = from.changes;
+    }
+  } // namespace
+
+  PipelinedSink::PipelinedSink(std::shared_ptr<Sink> sink,
+                               std::size_t capacity)
+    : sink(std::move(sink)) {
+    for (std::size_t i = 0; i < std::max(capacity, 1UL); i++) {
+      free.push_back(std::make_unique<Frame>(
+        Frame { nullptr, Population<Human>(0), Population<Mosquito>(0) }));
+    }
+    worker = std::thread([this] { work(); });
+  }
+
+  PipelinedSink::~PipelinedSink() {
+    {
+      const auto lock = std::scoped_lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+  }
+
+  auto PipelinedSink::work() -> void {
+    auto lock = std::unique_lock(mutex);
+    while (true) {
+      changed.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) {
+        return;
+      }
+
+      auto frame = std::move(queue.front());
+      queue.pop_front();
+      recording++;
+      lock.unlock();
+
+      try {
+        sink->record(*frame->state, frame->humans, frame->mosquitos);
+      } catch (...) {
+        lock.lock();
+        error = std::current_exception();
+        lock.unlock();
+      }
+
+      lock.lock();
+      recording--;
+      free.push_back(std::move(frame));
+      changed.notify_all();
+    }
+  }
+
+  auto PipelinedSink::rethrow() -> void {
+    if (error) {
+      std::rethrow_exception(std::exchange(error, nullptr));
+    }
+  }
+
+  auto PipelinedSink::record(State& state, const Population<Human>& humans,
+                             const Population<Mosquito>& mosquitos) -> void {
+    auto lock = std::unique_lock(mutex);
+    // backpressure, wait for the worker to give a buffer back
+    changed.wait(lock, [this] { return !free.empty() || error; });
+    rethrow();
+
+    auto frame = std::move(free.back());
+    free.pop_back();
+    lock.unlock();
+
+    frame->state = &state;
+    if (sink->records_agents(state.progress.first)) {
+      copy(frame->humans, humans);
+      copy(frame->mosquitos, mosquitos);
+    }
+
+    lock.lock();
+    queue.push_back(std::move(frame));
+    changed.notify_all();
+  }
+
+  auto PipelinedSink::records_agents(std::size_t cycle) const -> bool {
+    return sink->records_agents(cycle);
+  }
+
+  auto PipelinedSink::flush() -> void {
+    auto lock = std::unique_lock(mutex);
+    changed.wait(lock, [this] { return queue.empty() && recording == 0; });
+    rethrow();
+    lock.unlock();
+
+    sink->flush();
+  }
+} // namespace simulator::output
@@ -0,0 +1,323 @@
+#include <simulator/output/results.hpp>
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace simulator::output {
+  namespace {
+    // columns are padded so that every column of a mapped file is aligned
+    constexpr auto pad(std::size_t size) noexcept -> std::size_t {
+      return (size + 7) & ~std::size_t { 7 };
+    }
+
+    struct Columns {
+      std::size_t human_states;
+      std::size_t human_positions;
+      std::size_t mosquito_states;
+      std::size_t mosquito_positions;
+    };
+
+    auto columns(const Results::Header& header, std::size_t frame) noexcept
+      -> Columns {
+      const auto human_states = Results::frame_offset(header, frame);
+      const auto human_positions = human_states + pad(header.humans);
+      const auto mosquito_states =
+        human_positions + pad(header.humans * sizeof(std::uint32_t));
+      const auto mosquito_positions = mosquito_states + pad(header.mosquitos);
+      return { human_states, human_positions, mosquito_states,
+               mosquito_positions };
+    }
+
+    /**
+     * @brief Smallest size of a file with the cycles recorded by `header`,
+     * or 0 when the header cannot be the one of a results file of `size`
+     * bytes
+     */
+    auto recorded_size(const Results::Header& header, std::size_t size) noexcept
+      -> std::size_t {
+      // bounds every product below, an agent takes at least a byte
+      if (header.recorded > header.cycles || header.cycles > size ||
+          header.humans > size || header.mosquitos > size) {
+        return 0;
+      }
+
+      if (header.every == 0 || header.recorded == 0) {
+        return Results::counts_offset(header.recorded + 1);
+      }
+      const auto frame = (header.recorded - 1) / header.every;
+      return columns(header, frame).mosquito_positions +
+        header.mosquitos * sizeof(std::uint32_t);
+    }
+  } // namespace
+
+  auto Results::counts_offset(std::size_t cycle) noexcept -> std::size_t {
+    return sizeof(Header) + (cycle - 1) * sizeof(Counts);
+  }
+
+  auto Results::frame_size(const Header& header) noexcept -> std::size_t {
+    return pad(header.humans) + pad(header.humans * sizeof(std::uint32_t)) +
+      pad(header.mosquitos) + pad(header.mosquitos * sizeof(std::uint32_t));
+  }
+
+  auto Results::frame_offset(const Header& header, std::size_t frame) noexcept
+    -> std::size_t {
+    return sizeof(Header) + header.cycles * sizeof(Counts) +
+      frame * frame_size(header);
+  }
+
+  ResultsWriter::ResultsWriter(const std::filesystem::path& path,
+                               const Parameters& parameters, std::size_t every,
+                               bool resume)
+    : path(path),
+      header { Results::magic,
+               Results::version,
+               static_cast<std::uint32_t>(every),
+               parameters.seed,
+               parameters.cycles,
+               0,
+               parameters.human_initial_susceptible +
+                 parameters.human_initial_exposed +
+                 parameters.human_initial_infected +
+                 parameters.human_initial_recovered,
+               parameters.mosquito_initial_susceptible +
+                 parameters.mosquito_initial_infected +
+                 parameters.mosquito_initial_recovered,
+               parameters } {
+    if (resume && std::filesystem::exists(path)) {
+      auto recorded = Results::Header {};
+      std::ifstream { path, std::ios::binary }.read(
+        reinterpret_cast<char*>(&recorded), sizeof(recorded));
+      if (recorded.magic != header.magic ||
+          recorded.version != header.version ||
+          recorded.every != header.every || recorded.seed != header.seed ||
+          recorded.cycles != header.cycles ||
+          recorded.humans != header.humans ||
+          recorded.mosquitos != header.mosquitos) {
+        throw std::runtime_error("results of another simulation: " +
+                                 path.string());
+      }
+
+      header.recorded = recorded.recorded;
+      file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+      if (!file) {
+        throw std::runtime_error("cannot open results file: " + path.string());
+      }
+      return;
+    }
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      throw std::runtime_error("cannot open results file: " + path.string());
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file) {
+      throw std::runtime_error("cannot write results file: " + path.string());
+    }
+  }
+
+  auto ResultsWriter::record(State& state, const Population<Human>& humans,
+                             const Population<Mosquito>& mosquitos) -> void {
+    const auto cycle = state.progress.first;
+    const auto [humans_s, humans_e, humans_i, humans_r] =
+      state.humans_in_states;
+    const auto [mosquitos_s, mosquitos_i, mosquitos_r] =
+      state.mosquitos_in_states;
+    const auto counts = Results::Counts {
+      cycle,
+      { humans_s, humans_e, humans_i, humans_r },
+      { mosquitos_s, mosquitos_i, mosquitos_r },
+      { state.incidence.first, state.incidence.second },
+    };
+
+    file.seekp(static_cast<std::streamoff>(Results::counts_offset(cycle)));
+    file.write(reinterpret_cast<const char*>(&counts), sizeof(counts));
+
+    if (records_agents(cycle)) {
+      const auto [human_states, human_positions, mosquito_states,
+                  mosquito_positions] =
+        columns(header, (cycle - 1) / header.every);
+      const auto write = [this](std::size_t offset, const auto& column) {
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(reinterpret_cast<const char*>(column.data()),
+                   static_cast<std::streamsize>(
+                     column.size() * sizeof(*column.data())));
+      };
+
+      write(human_states, humans.states);
+      write(human_positions, humans.positions);
+      write(mosquito_states, mosquitos.states);
+      write(mosquito_positions, mosquitos.positions);
+    }
+
+    if (!file) {
+      throw std::runtime_error("cannot write results file: " + path.string());
+    }
+    header.recorded = cycle;
+  }
+
+  auto ResultsWriter::flush() -> void {
+    // the cycles reach the file before the header counting them
+    file.flush();
+    file.seekp(offsetof(Results::Header, recorded));
+    file.write(reinterpret_cast<const char*>(&header.recorded),
+               sizeof(header.recorded));
+    file.flush();
+    if (!file) {
+      throw std::runtime_error("cannot write results file: " + path.string());
+    }
+  }
+
+  auto ResultsWriter::records_agents(std::size_t cycle) const -> bool {
+    return header.every != 0 && (cycle - 1) % header.every == 0;
+  }
+
+  auto make_results_writer(const std::filesystem::path& path,
+                           std::string_view mode, std::size_t every,
+                           const Parameters& parameters, bool resume)
+    -> std::shared_ptr<ResultsWriter> {
+    if (mode == "aggregate") {
+      every = 0;
+    } else if (mode == "full") {
+      every = 1;
+    } else if (mode != "snapshot") {
+      throw std::invalid_argument(
+        "output mode not supported by the binary format: " + std::string(mode));
+    }
+
+    std::filesystem::create_directories(path.parent_path());
+    return std::make_shared<ResultsWriter>(path, parameters, every, resume);
+  }
+
+  ResultsReader::ResultsReader(const std::filesystem::path& path) {
+    const auto descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      throw std::system_error(errno, std::generic_category(), path.string());
+    }
+
+    struct stat status {};
+    ::fstat(descriptor, &status);
+    size = static_cast<std::size_t>(status.st_size);
+    if (size < sizeof(Results::Header)) {
+      ::close(descriptor);
+      throw std::runtime_error("truncated results file: " + path.string());
+    }
+
+    auto* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), path.string());
+    }
+    data = static_cast<const std::byte*>(mapping);
+
+    if (header().magic != Results::magic ||
+        header().version != Results::version) {
+      ::munmap(mapping, size);
+      throw std::runtime_error("not a results file: " + path.string());
+    }
+
+    const auto recorded = recorded_size(header(), size);
+    if (recorded == 0 || recorded > size) {
+      ::munmap(mapping, size);
+      throw std::runtime_error("truncated results file: " + path.string());
+    }
+  }
+
+  ResultsReader::~ResultsReader() {
+    ::munmap(const_cast<std::byte*>(data), size);
+  }
+
+  auto ResultsReader::header() const noexcept -> const Results::Header& {
+    return *reinterpret_cast<const Results::Header*>(data);
+  }
+
+  auto ResultsReader::counts() const noexcept
+    -> std::span<const Results::Counts> {
+    return { reinterpret_cast<const Results::Counts*>(
+               data + Results::counts_offset(1)),
+             header().recorded };
+  }
+
+  auto ResultsReader::has_agents(std::size_t cycle) const noexcept -> bool {
+    return header().every != 0 && cycle <= header().recorded &&
+      (cycle - 1) % header().every == 0;
+  }
+
+  auto ResultsReader::human_states(std::size_t cycle) const noexcept
+    -> std::span<const Human::State> {
+    assert(has_agents(cycle));
+    const auto offset =
+      columns(header(), (cycle - 1) / header().every).human_states;
+    return { reinterpret_cast<const Human::State*>(data + offset),
+             header().humans };
+  }
+
+  auto ResultsReader::human_positions(std::size_t cycle) const noexcept
+    -> std::span<const std::uint32_t> {
+    assert(has_agents(cycle));
+    const auto offset =
+      columns(header(), (cycle - 1) / header().every).human_positions;
+    return { reinterpret_cast<const std::uint32_t*>(data + offset),
+             header().humans };
+  }
+
+  auto ResultsReader::mosquito_states(std::size_t cycle) const noexcept
+    -> std::span<const Mosquito::State> {
+    assert(has_agents(cycle));
+    const auto offset =
+      columns(header(), (cycle - 1) / header().every).mosquito_states;
+    return { reinterpret_cast<const Mosquito::State*>(data + offset),
+             header().mosquitos };
+  }
+
+  auto ResultsReader::mosquito_positions(std::size_t cycle) const noexcept
+    -> std::span<const std::uint32_t> {
+    assert(has_agents(cycle));
+    const auto offset =
+      columns(header(), (cycle - 1) / header().every).mosquito_positions;
+    return { reinterpret_cast<const std::uint32_t*>(data + offset),
+             header().mosquitos };
+  }
+
+  auto ResultsReader::states(bool agents) const -> std::vector<State> {
+    std::vector<State> states;
+    states.reserve(header().recorded);
+
+    for (const auto& counts : this->counts()) {
+      auto& state = states.emplace_back();
+      state.progress = { counts.cycle, header().cycles };
+      state.humans_in_states = { counts.humans[0], counts.humans[1],
+                                 counts.humans[2], counts.humans[3] };
+      state.mosquitos_in_states = { counts.mosquitos[0], counts.mosquitos[1],
+                                    counts.mosquitos[2] };
+      state.incidence = { counts.incidence[0], counts.incidence[1] };
+
+      if (!agents || !has_agents(counts.cycle)) {
+        continue;
+      }
+
+      const auto human_states = this->human_states(counts.cycle);
+      const auto human_positions = this->human_positions(counts.cycle);
+      for (std::size_t id = 0; id < human_states.size(); id++) {
+        state.humans.push_back(
+          Human { human_states[id], id, human_positions[id], 0 });
+      }
+      const auto mosquito_states = this->mosquito_states(counts.cycle);
+      const auto mosquito_positions = this->mosquito_positions(counts.cycle);
+      for (std::size_t id = 0; id < mosquito_states.size(); id++) {
+        state.mosquitos.push_back(
+          Mosquito { mosquito_states[id], id, mosquito_positions[id], 0 });
+      }
+    }
+
+    return states;
+  }
+} // namespace simulator::output
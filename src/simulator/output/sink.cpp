@@ -0,0 +1,160 @@
+#include <simulator/output/history.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/util/random.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+namespace simulator::output {
+  namespace {
+    /**
+     * @brief Draw `size` distinct ids in `[0, population)`, Floyd's algorithm
+     */
+    auto sample_ids(std::size_t population, std::size_t size,
+                    std::uint64_t seed, std::uint64_t kind)
+      -> std::vector<std::size_t> {
+      size = std::min(size, population);
+      std::unordered_set<std::size_t> ids;
+      for (auto j = population - size; j < population; j++) {
+        const auto random =
+          util::make_counter_rng(0UL, j, seed, util::Stream::Cohort);
+        const auto id = random(kind, j);
+        ids.insert(ids.contains(id) ? j : id);
+      }
+
+      auto sorted = std::vector<std::size_t>(std::begin(ids), std::end(ids));
+      std::sort(std::begin(sorted), std::end(sorted));
+      return sorted;
+    }
+  } // namespace
+
+  auto AggregateSink::record(State& /*state*/,
+                             const Population<Human>& /*humans*/,
+                             const Population<Mosquito>& /*mosquitos*/)
+    -> void {}
+
+  auto AggregateSink::records_agents(std::size_t /*cycle*/) const -> bool {
+    return false;
+  }
+
+  SnapshotSink::SnapshotSink(std::size_t every) : every(std::max(every, 1UL)) {}
+
+  auto SnapshotSink::record(State& state, const Population<Human>& humans,
+                            const Population<Mosquito>& mosquitos) -> void {
+    if (!records_agents(state.progress.first)) {
+      return;
+    }
+
+    state.humans.reserve(humans.size());
+    for (std::size_t i = 0; i < humans.size(); i++) {
+      state.humans.push_back(humans[i]);
+    }
+    state.mosquitos.reserve(mosquitos.size());
+    for (std::size_t i = 0; i < mosquitos.size(); i++) {
+      state.mosquitos.push_back(mosquitos[i]);
+    }
+  }
+
+  auto SnapshotSink::records_agents(std::size_t cycle) const -> bool {
+    return (cycle - 1) % every == 0;
+  }
+
+  CohortSink::CohortSink(std::vector<std::size_t> humans,
+                         std::vector<std::size_t> mosquitos)
+    : humans(std::move(humans)), mosquitos(std::move(mosquitos)) {}
+
+  auto CohortSink::sample(const Parameters& parameters, std::size_t size)
+    -> CohortSink {
+    const auto humans = parameters.human_initial_susceptible +
+      parameters.human_initial_exposed + parameters.human_initial_infected +
+      parameters.human_initial_recovered;
+    const auto mosquitos = parameters.mosquito_initial_susceptible +
+      parameters.mosquito_initial_infected +
+      parameters.mosquito_initial_recovered;
+
+    return { sample_ids(humans, size, parameters.seed, 0),
+             sample_ids(mosquitos, size, parameters.seed, 1) };
+  }
+
+  auto CohortSink::record(State& state, const Population<Human>& humans,
+                          const Population<Mosquito>& mosquitos) -> void {
+    state.humans.reserve(this->humans.size());
+    for (const auto id : this->humans) {
+      state.humans.push_back(humans[id]);
+    }
+    state.mosquitos.reserve(this->mosquitos.size());
+    for (const auto id : this->mosquitos) {
+      state.mosquitos.push_back(mosquitos[id]);
+    }
+  }
+
+  RenumberedSink::RenumberedSink(std::shared_ptr<Sink> sink,
+                                 Environment environment)
+    : sink(std::move(sink)), environment(std::move(environment)) {}
+
+  auto RenumberedSink::record(State& state, const Population<Human>& humans,
+                              const Population<Mosquito>& mosquitos)
+    -> void {
+    if (!sink->records_agents(state.progress.first)) {
+      sink->record(state, humans, mosquitos);
+      return;
+    }
+
+    const auto translate = [this](auto& copy, const auto& population) {
+      copy.states = population.states;
+      copy.counters = population.counters;
+      copy.changes = population.changes;
+      copy.positions.resize(population.positions.size());
+      std::transform(std::begin(population.positions),
+                     std::end(population.positions),
+                     std::begin(copy.positions), [this](auto position) {
+                       return environment.input(position);
+                     });
+    };
+
+    translate(this->humans, humans);
+    translate(this->mosquitos, mosquitos);
+    sink->record(state, this->humans, this->mosquitos);
+  }
+
+  auto RenumberedSink::records_agents(std::size_t cycle) const -> bool {
+    return sink->records_agents(cycle);
+  }
+
+  auto RenumberedSink::flush() -> void {
+    sink->flush();
+  }
+
+  auto renumbered(std::shared_ptr<Sink> sink, const Environment& environment)
+    -> std::shared_ptr<Sink> {
+    if (environment.inputs.empty() ||
+        std::dynamic_pointer_cast<AggregateSink>(sink) != nullptr) {
+      return sink;
+    }
+    return std::make_shared<RenumberedSink>(std::move(sink), environment);
+  }
+
+  auto make_sink(std::string_view mode, std::size_t every, std::size_t cohort,
+                 const Parameters& parameters) -> std::shared_ptr<Sink> {
+    if (mode == "aggregate") {
+      return std::make_shared<AggregateSink>();
+    }
+    if (mode == "snapshot") {
+      return std::make_shared<SnapshotSink>(every);
+    }
+    if (mode == "cohort") {
+      return std::make_shared<CohortSink>(
+        CohortSink::sample(parameters, cohort));
+    }
+    if (mode == "full") {
+      return std::make_shared<SnapshotSink>(1);
+    }
+    if (mode == "history") {
+      return std::make_shared<HistorySink>(every);
+    }
+    throw std::invalid_argument("unknown output mode: " + std::string(mode));
+  }
+} // namespace simulator::output
@@ -1,6 +1,9 @@
 #include <simulator/parameters.hpp>
 #include <simulator/util/random.hpp>
 
+#include <cstdint>
+#include <optional>
+#include <random>
 #include <string_view>
 
 #include <nlohmann/json.hpp>
@@ -8,9 +11,28 @@
 namespace simulator {
   using json = nlohmann::json;
 
-  auto Parameters::from_json(const std::string_view data) -> Parameters {
+  auto Parameters::from_json(const std::string_view data,
+                             std::optional<std::uint64_t> seed) -> Parameters {
     const json json_data = json::parse(data);
 
+    if (!seed.has_value() && json_data.contains("seed")) {
+      seed = json_data["seed"].get<std::uint64_t>();
+    }
+    if (!seed.has_value()) {
+      seed = (static_cast<std::uint64_t>(std::random_device {}()) << 32) |
+        std::random_device {}();
+    }
+
+    // each parameter is drawn from its own counter, so the sampled values
+    // only depend on the seed
+    auto field = 0UL;
+    const auto sample = [&field, seed = seed.value()](const auto& range) {
+      const auto [min, max] = range;
+      const auto random =
+        util::make_counter_rng(min, max, seed, util::Stream::Parameters);
+      return random(0, field++);
+    };
+
     const auto& runs = json_data["runs"].get<std::size_t>();
     const auto& cycles = json_data["cycles"].get<std::size_t>();
 
@@ -62,47 +84,20 @@ namespace simulator {
 
     return { runs,
              cycles,
-             util::make_cpu_rng(
-               std::get<0>(human_infection_rate),
-               std::get<1>(human_infection_rate))(),
-             util::make_cpu_rng(
-               std::get<0>(human_initial_susceptible),
-               std::get<1>(human_initial_susceptible))(),
-             util::make_cpu_rng(
-               std::get<0>(human_initial_exposed),
-               std::get<1>(human_initial_exposed))(),
-             util::make_cpu_rng(
-               std::get<0>(human_initial_infected),
-               std::get<1>(human_initial_infected))(),
-             util::make_cpu_rng(
-               std::get<0>(human_initial_recovered),
-               std::get<1>(human_initial_recovered))(),
-             util::make_cpu_rng(
-               std::get<0>(human_transition_period_exposed),
-               std::get<1>(human_transition_period_exposed))(),
-             util::make_cpu_rng(
-               std::get<0>(human_transition_period_infected),
-               std::get<1>(human_transition_period_infected))(),
-             util::make_cpu_rng(
-               std::get<0>(human_transition_period_recovered),
-               std::get<1>(human_transition_period_recovered))(),
-             util::make_cpu_rng(
-               std::get<0>(mosquito_infection_rate),
-               std::get<1>(mosquito_infection_rate))(),
-             util::make_cpu_rng(
-               std::get<0>(mosquito_initial_susceptible),
-               std::get<1>(mosquito_initial_susceptible))(),
-             util::make_cpu_rng(
-               std::get<0>(mosquito_initial_infected),
-               std::get<1>(mosquito_initial_infected))(),
-             util::make_cpu_rng(
-               std::get<0>(mosquito_initial_recovered),
-               std::get<1>(mosquito_initial_recovered))(),
-             util::make_cpu_rng(
-               std::get<0>(mosquito_transition_period_infected),
-               std::get<1>(mosquito_transition_period_infected))(),
-             util::make_cpu_rng(
-               std::get<0>(mosquito_transition_period_recovered),
-               std::get<1>(mosquito_transition_period_recovered))() };
+             sample(human_infection_rate),
+             sample(human_initial_susceptible),
+             sample(human_initial_exposed),
+             sample(human_initial_infected),
+             sample(human_initial_recovered),
+             sample(human_transition_period_exposed),
+             sample(human_transition_period_infected),
+             sample(human_transition_period_recovered),
+             sample(mosquito_infection_rate),
+             sample(mosquito_initial_susceptible),
+             sample(mosquito_initial_infected),
+             sample(mosquito_initial_recovered),
+             sample(mosquito_transition_period_infected),
+             sample(mosquito_transition_period_recovered),
+             seed.value() };
   }
 } // namespace simulator
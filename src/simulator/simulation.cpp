@@ -1,596 +1,1116 @@
+#include <simulator/checkpoint.hpp>
 #include <simulator/environment.hpp>
+#include <simulator/frontier.hpp>
 #include <simulator/human.hpp>
 #include <simulator/mosquito.hpp>
+#include <simulator/population.hpp>
+#include <simulator/rules.hpp>
 #include <simulator/simulation.hpp>
 #include <simulator/state.hpp>
 #include <simulator/util/functional.hpp>
+#include <simulator/util/numa.hpp>
 #include <simulator/util/random.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <exception>
 #include <execution>
+#include <iostream>
+#include <latch>
 #include <memory>
-#include <tuple>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <stdexec/execution.hpp>
 
 namespace simulator {
+  namespace {
+    // 4 human and 3 mosquito compartments per replica
+    constexpr auto compartments = std::size_t { 7 };
+
+    // agents per chunk of the kernels counting their state changes
+    constexpr auto chunk = std::size_t { 1024 };
+
+    /**
+     * @brief State changes of a cycle, a.k.a. the index of their counter in
+     * the flows of a replica
+     */
+    enum Flow : std::uint8_t {
+      HumanExposed,
+      HumanInfected,
+      HumanRecovered,
+      HumanSusceptible,
+      MosquitoInfected,
+      MosquitoRecovered,
+      MosquitoSusceptible,
+      // no state change, also the number of flows
+      None,
+    };
+
+    /**
+     * @brief Make the occupancy cell of the agents of a population, the
+     * cells of the replicas are laid out one after the other
+     */
+    template <typename Agent>
+    auto make_cell(const Population<Agent>* population, std::size_t cells,
+                   std::size_t replicas) noexcept {
+      return [population, cells,
+              size = population->size() / replicas](auto i) noexcept {
+        return i / size * cells + population->positions[i];
+      };
+    }
+
+    /**
+     * @brief State change of an agent entering `state`
+     */
+    constexpr auto flow(Human::State state) noexcept -> Flow {
+      switch (state) {
+        case Human::State::Exposed:
+          return HumanExposed;
+        case Human::State::Infected:
+          return HumanInfected;
+        case Human::State::Recovered:
+          return HumanRecovered;
+        case Human::State::Susceptible:
+          return HumanSusceptible;
+      }
+      return None;
+    }
+
+    constexpr auto flow(Mosquito::State state) noexcept -> Flow {
+      switch (state) {
+        case Mosquito::State::Infected:
+          return MosquitoInfected;
+        case Mosquito::State::Recovered:
+          return MosquitoRecovered;
+        case Mosquito::State::Susceptible:
+          return MosquitoSusceptible;
+      }
+      return None;
+    }
+
+    /**
+     * @brief Make the transition kernel of a population, returning the state
+     * change of the agent
+     */
+    template <typename Agent>
+    auto make_transition(Population<Agent>* population,
+                         const Parameters* parameters, Frontier* frontier,
+                         std::size_t cells, std::size_t replicas) noexcept {
+      return [population, parameters, frontier,
+              cell = make_cell(population, cells, replicas)](auto i) noexcept
+               -> Flow {
+        auto& state = population->states[i];
+        const auto previous = state;
+        if (!simulator::transition(state, population->counters[i],
+                                   *parameters)) {
+          return None;
+        }
+        population->changes[i] |= Population<Agent>::StateChanged;
+        frontier->remove(Frontier::kind(previous), cell(i));
+        frontier->add(Frontier::kind(state), cell(i));
+        return flow(state);
+      };
+    }
+
+    /**
+     * @brief Make the movement kernel of a population
+     *
+     * Agent `i` moves to a random neighbour, written to `next[i]` (the
+     * positions themselves when null) and flagged with `moved`. Arrivals and
+     * departures are counted in `occupancy` and `frontier`.
+     */
+    template <typename Agent>
+    auto make_movement(
+      const Environment* environment, Population<Agent>* population,
+      Occupancy* occupancy, Frontier* frontier, util::Stream stream,
+      std::size_t replicas,
+      std::uint64_t seed, std::size_t iteration,
+      std::uint32_t* next = nullptr,
+      std::uint8_t moved = Population<Agent>::PositionChanged) noexcept {
+      const auto random_position =
+        util::make_counter_rng(0UL, environment->size - 1, seed, stream);
+      next = next != nullptr ? next : population->positions.data();
+
+      return [random_position, environment, population, occupancy, frontier,
+              iteration, next, moved,
+              size = population->size() / replicas](auto i) noexcept {
+        const auto position = population->positions[i];
+        const auto edges = environment->edges(position);
+        const auto target =
+          edges[random_position(iteration, population->id(i)) %
+                edges.size()];
+        next[i] = target;
+        if (target != position) {
+          // cells of the replica of the agent
+          const auto cells = i / size * environment->size;
+          occupancy->depart(cells + position);
+          occupancy->arrive(cells + target);
+          const auto kind = Frontier::kind(population->states[i]);
+          frontier->remove(kind, cells + position);
+          frontier->add(kind, cells + target);
+          population->changes[i] |= moved;
+        }
+      };
+    }
+
+    /**
+     * @brief Agents per index of the kernels counting their state changes
+     *
+     * The gpu runs a thread per agent, chunks would leave it with a thread
+     * per `chunk` agents. The host only build runs the gpu placement on the
+     * thread pool, chunked as the cpu.
+     */
+    constexpr auto chunk_of([[maybe_unused]] Placement placement) noexcept
+      -> std::size_t {
+#ifndef SIMULATOR_HOST_ONLY
+      if (placement == Placement::Gpu) {
+        return 1;
+      }
+#endif
+      return chunk;
+    }
+
+    /**
+     * @brief Make a kernel running `kernel` over chunks of agents
+     *
+     * `kernel` returns the state change of an agent, the changes of a chunk
+     * are counted locally and added to `flows` (`None` per replica) once per
+     * chunk, so the totals only contend on the chunks. With a chunk of a
+     * single agent (on the gpu) only the changes are added, so the agents
+     * keeping their state do not touch the totals.
+     */
+    template <typename Agent, typename Kernel>
+    auto make_counted(const Population<Agent>* population, Kernel kernel,
+                      std::size_t replicas, std::size_t* flows,
+                      Placement placement) noexcept {
+      const auto size = population->size() / replicas;
+      const auto width = chunk_of(placement);
+      const auto chunks = (size + width - 1) / width;
+
+      return std::make_pair(
+        replicas * chunks,
+        [kernel, flows, size, width, chunks](auto k) noexcept {
+          const auto replica = k / chunks;
+          const auto begin = replica * size + k % chunks * width;
+          if (width == 1) {
+            const auto flow = kernel(begin);
+            if (flow != None) {
+              std::atomic_ref(flows[replica * None + flow])
+                .fetch_add(1, std::memory_order_relaxed);
+            }
+            return;
+          }
+
+          const auto end = std::min(begin + width, (replica + 1) * size);
+
+          auto local = std::array<std::size_t, None + 1> {};
+          for (auto i = begin; i < end; i++) {
+            local[kernel(i)]++;
+          }
+
+          for (std::size_t flow = 0; flow < None; flow++) {
+            if (local[flow] != 0) {
+              std::atomic_ref(flows[replica * None + flow])
+                .fetch_add(local[flow], std::memory_order_relaxed);
+            }
+          }
+        });
+    }
+
+    /**
+     * @brief Whether a simulation owning its threads gets the pools of the
+     * NUMA nodes
+     *
+     * Only in the host only build, the gpu build allocates every column in
+     * managed memory, whose pages are not released by `util::release`.
+     */
+    constexpr auto numa_of([[maybe_unused]] const Execution& execution) noexcept
+      -> bool {
+#ifdef SIMULATOR_HOST_ONLY
+      return execution.numa;
+#else
+      return false;
+#endif
+    }
+  } // namespace
+
+  template <typename... Kernels>
+  auto Simulation::launch(Placement placement,
+                          std::pair<std::size_t, Kernels>... kernels) noexcept
+    -> void {
+    switch (placement) {
+      case Placement::Sync: {
+        const auto run = [](const auto& kernel) {
+          auto range = std::vector<std::size_t>(kernel.first);
+          std::iota(std::begin(range), std::end(range), 0UL);
+          std::for_each(std::execution::par_unseq, std::begin(range),
+                        std::end(range), kernel.second);
+        };
+        (run(kernels), ...);
+        break;
+      }
+#ifdef SIMULATOR_HOST_ONLY
+      case Placement::Gpu:
+#endif
+      case Placement::Cpu:
+        if (!nodes.empty()) {
+          // every node runs its contiguous share of each bulk, the same
+          // share of the columns it first touched
+          auto done = std::latch(
+            static_cast<std::ptrdiff_t>(nodes.size() * sizeof...(kernels)));
+          const auto spread = [this, &done](const auto& kernel) {
+            for (std::size_t node = 0; node < nodes.size(); node++) {
+              const auto first = kernel.first * node / nodes.size();
+              const auto last = kernel.first * (node + 1) / nodes.size();
+              stdexec::start_detached(
+                stdexec::just() |
+                exec::on(nodes[node]->get_scheduler(),
+                         stdexec::bulk(last - first,
+                                       [first, kernel = kernel.second](
+                                         auto i) noexcept {
+                                         kernel(first + i);
+                                       })) |
+                stdexec::then([&done]() noexcept { done.count_down(); }));
+            }
+          };
+          (spread(kernels), ...);
+          done.wait();
+          break;
+        }
+        stdexec::sync_wait(stdexec::when_all(
+          (stdexec::just() |
+           exec::on(cpu->get_scheduler(),
+                    stdexec::bulk(kernels.first, kernels.second)))...));
+        break;
+#ifndef SIMULATOR_HOST_ONLY
+      case Placement::Gpu:
+        stdexec::sync_wait(stdexec::when_all(
+          (stdexec::just() |
+           exec::on(gpu.get_scheduler(nvexec::stream_priority::high),
+                    stdexec::bulk(kernels.first, kernels.second)))...));
+        break;
+#endif
+    }
+  }
+
+  template <typename T>
+  auto Simulation::place(std::vector<T>& column) noexcept -> void {
+    auto placed = std::vector<T>(column.size());
+    util::release(placed.data(), placed.size() * sizeof(T));
+    launch(Placement::Cpu,
+           std::make_pair(placed.size(),
+                          [from = column.data(),
+                           to = placed.data()](auto i) noexcept {
+                            to[i] = from[i];
+                          }));
+    column.swap(placed);
+  }
+
   Simulation::Simulation(std::shared_ptr<const Environment> environment,
                          std::shared_ptr<const Parameters> parameters,
-                         std::size_t threads) noexcept
+                         std::size_t threads,
+                         std::shared_ptr<output::Sink> sink,
+                         std::size_t replicas, Execution execution) noexcept
+    : Simulation(std::move(environment), std::move(parameters),
+                 numa_of(execution)
+                   ? nullptr
+                   : std::make_shared<exec::static_thread_pool>(
+                       static_cast<uint32_t>(threads)),
+                 std::move(sink), replicas, execution) {
+    // only a simulation owning its threads gets the pools of the NUMA
+    // nodes, the simulations sharing an external pool keep it
+    if (!numa_of(this->execution)) {
+      return;
+    }
+
+    // the workers inherit the cpus of the thread starting them
+    for (const auto& cpus : util::Topology::detect().nodes) {
+      const auto previous = util::bind(cpus);
+      nodes.push_back(std::make_shared<exec::static_thread_pool>(
+        static_cast<std::uint32_t>(cpus.size())));
+      util::bind(previous);
+    }
+
+    const auto place_population = [this](auto& population) {
+      place(population.states);
+      place(population.positions);
+      place(population.counters);
+      place(population.changes);
+      place(population.next_states);
+      place(population.next_positions);
+    };
+    const auto place_occupancy = [this](auto& occupancy) {
+      place(occupancy.counts);
+      place(occupancy.offsets);
+      place(occupancy.agents);
+      place(occupancy.cursors);
+      place(occupancy.ids);
+    };
+    place_population(*humans);
+    place_population(*mosquitos);
+    place_occupancy(*humans_in_position);
+    place_occupancy(*mosquitos_in_position);
+    place(frontier->counts);
+    place(frontier->cells);
+    place(frontier->active);
+  }
+
+  Simulation::Simulation(std::shared_ptr<const Environment> environment,
+                         std::shared_ptr<const Parameters> parameters,
+                         std::shared_ptr<exec::static_thread_pool> pool,
+                         std::shared_ptr<output::Sink> sink,
+                         std::size_t replicas, Execution execution) noexcept
     : environment(std::move(environment)), parameters(std::move(parameters)),
-      cpu { static_cast<uint32_t>(threads) }, gpu {},
-      humans(std::make_unique<std::vector<Human>>(
-        this->parameters->human_initial_susceptible +
-        this->parameters->human_initial_exposed +
-        this->parameters->human_initial_infected +
-        this->parameters->human_initial_recovered)),
-      mosquitos(std::make_unique<std::vector<Mosquito>>(
-        this->parameters->mosquito_initial_susceptible +
-        this->parameters->mosquito_initial_infected +
-        this->parameters->mosquito_initial_recovered)),
-      agents_in_position(
-        std::make_unique<std::vector<
-          std::pair<std::vector<std::int64_t>, std::vector<std::int64_t>>>>(
-          std::vector<
-            std::pair<std::vector<std::int64_t>, std::vector<std::int64_t>>>(
-            this->environment->size,
-            std::make_pair(
-              std::vector<std::int64_t>(this->humans->size(), -1),
-              std::vector<std::int64_t>(this->mosquitos->size(), -1))))),
-      states(std::make_unique<std::vector<State>>()) {}
+      seed(this->parameters->seed), replicas(std::max(replicas, 1UL)),
+      execution(execution), cpu(std::move(pool)),
+      humans(std::make_unique<Population<Human>>(
+        this->replicas *
+        (this->parameters->human_initial_susceptible +
+         this->parameters->human_initial_exposed +
+         this->parameters->human_initial_infected +
+         this->parameters->human_initial_recovered))),
+      mosquitos(std::make_unique<Population<Mosquito>>(
+        this->replicas *
+        (this->parameters->mosquito_initial_susceptible +
+         this->parameters->mosquito_initial_infected +
+         this->parameters->mosquito_initial_recovered))),
+      humans_in_position(std::make_unique<Occupancy>(
+        this->replicas * this->environment->size, this->humans->size())),
+      mosquitos_in_position(std::make_unique<Occupancy>(
+        this->replicas * this->environment->size, this->mosquitos->size())),
+      frontier(std::make_unique<Frontier>(this->replicas *
+                                          this->environment->size)),
+      ordered_humans(std::make_unique<Population<Human>>(0)),
+      ordered_mosquitos(std::make_unique<Population<Mosquito>>(0)),
+      states(std::make_unique<std::vector<std::vector<State>>>(this->replicas)),
+      sink(this->replicas > 1 ? std::make_shared<output::AggregateSink>()
+             : sink           ? std::move(sink)
+                              : std::make_shared<output::SnapshotSink>()) {
+    // sinks may record a state after `output` returns, so the states never
+    // move
+    for (auto& states : *this->states) {
+      states.reserve(this->parameters->cycles);
+    }
+
+    if (this->execution.fused) {
+      humans->next_positions.resize(humans->size());
+      mosquitos->next_positions.resize(mosquitos->size());
+    }
+  }
+
+  Simulation::~Simulation() {
+    // a simulation stopped before its last cycle was not flushed
+    try {
+      sink->flush();
+    } catch (const std::exception& e) {
+      std::cerr << "cannot record the last cycles: " << e.what() << std::endl;
+    }
+  }
 
   auto Simulation::prepare() noexcept -> void {
     insertion();
   }
 
-  auto Simulation::iterate() noexcept -> std::optional<const State* const> {
+  auto Simulation::iterate() -> std::optional<const State* const> {
     if (iteration >= parameters->cycles) {
+      sink->flush();
+      if (checkpoints) {
+        checkpoints->flush();
+      }
       return std::nullopt;
     }
 
-    movement();
-    contact();
-    transition();
-    auto& state = output();
+    auto& state = step();
 
     // TFW no std::optional in C++ :(
     return &state;
   }
 
-  auto Simulation::run() noexcept -> void {
+  auto Simulation::run() -> void {
     const auto cycles = parameters->cycles;
 
-    insertion();
-    for (std::size_t i = 0; i < cycles; i++) {
-      // std::cout << "Cycle: " << i << std::endl;
+    // a resumed simulation already has its agents
+    if (iteration == 0) {
+      insertion();
+    }
+    while (iteration < cycles) {
+      // std::cout << "Cycle: " << iteration << std::endl;
+      static_cast<void>(step());
+    }
+    sink->flush();
+    if (checkpoints) {
+      checkpoints->flush();
+    }
+  }
+
+  auto Simulation::step() -> const State& {
+    if (execution.sort_interval != 0 && iteration != 0 &&
+        iteration % execution.sort_interval == 0) {
+      sort();
+    }
+
+    if (!execution.fused) {
       movement();
       contact();
       transition();
-      auto _ = output();
+      return output();
     }
+
+    // the first movement (or the first after a checkpoint) has no previous
+    // transition to be fused with, the next ones were counted by the fused
+    // pass and only need the scatter
+    if (iteration == resumed) {
+      movement();
+    } else {
+      humans_in_position->rebuild(
+        make_cell(humans.get(), environment->size, replicas));
+      mosquitos_in_position->rebuild(
+        make_cell(mosquitos.get(), environment->size, replicas));
+    }
+    contact();
+    fused();
+    return output();
   }
 
   auto Simulation::insertion() noexcept -> void {
-    auto random_human_position = util::make_gpu_rng(
-      0UL, environment->size - 1,
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    // positions are drawn in the input ids of the environment, so every
+    // ordering of the nodes inserts the agents at the same places
+    const auto node = [environment = environment.get()](auto random) noexcept {
+      return [environment, random](auto cycle, auto agent) noexcept {
+        return environment->node(random(cycle, agent));
+      };
+    };
+
+    const auto random_human_position = node(util::make_counter_rng(
+      0UL, environment->size - 1, seed, util::Stream::HumanInsertion));
+
+    // the `i`th inserted agent of a group of `count` agents starting at
+    // `first` is in the replica `i / count`
+    const auto agent_id = [](std::size_t i, std::size_t first,
+                             std::size_t count, std::size_t size) noexcept {
+      return i / count * size + first + i % count;
+    };
+    const auto humans_size = humans->size() / replicas;
 
     const auto insert_susceptible_human =
-      [random_human_position, humans = humans.get(),
-       agents_in_position = agents_in_position.get()](unsigned long long i) mutable noexcept {
-        const auto position = random_human_position(i);
-        (*humans)[i] = Human { Human::State::Susceptible, i, position, 0 };
-        std::get<0>((*agents_in_position)[position])[i] = i;
+      [random_human_position, agent_id, humans = humans.get(),
+       count = parameters->human_initial_susceptible,
+       size = humans_size](unsigned long long i) noexcept {
+        const auto idx = agent_id(i, 0, count, size);
+        humans->insert(idx, Human::State::Susceptible,
+                       random_human_position(0, idx));
       };
 
     const auto insert_infected_human =
-      [random_human_position, humans = humans.get(),
-       agents_in_position = agents_in_position.get(),
-       inital_index =
-         parameters->human_initial_infected](auto i) mutable noexcept {
-        const auto idx = inital_index + i;
-        (*humans)[idx] =
-          Human { Human::State::Infected, idx, random_human_position(idx), 0 };
-        std::get<0>((*agents_in_position)[(*humans)[idx].position])[idx] = idx;
+      [random_human_position, agent_id, humans = humans.get(),
+       inital_index = parameters->human_initial_susceptible +
+         parameters->human_initial_exposed,
+       count = parameters->human_initial_infected,
+       size = humans_size](auto i) noexcept {
+        const auto idx = agent_id(i, inital_index, count, size);
+        humans->insert(idx, Human::State::Infected,
+                       random_human_position(0, idx));
       };
 
     const auto insert_exposed_human =
-      [random_human_position, humans = humans.get(),
-       agents_in_position = agents_in_position.get(),
-       inital_index =
-         parameters->human_initial_susceptible](auto i) mutable noexcept {
-        const auto idx = inital_index + i;
-        (*humans)[idx] =
-          Human { Human::State::Exposed, idx, random_human_position(idx), 0 };
-        std::get<0>((*agents_in_position)[(*humans)[idx].position])[idx] = idx;
+      [random_human_position, agent_id, humans = humans.get(),
+       inital_index = parameters->human_initial_susceptible,
+       count = parameters->human_initial_exposed,
+       size = humans_size](auto i) noexcept {
+        const auto idx = agent_id(i, inital_index, count, size);
+        humans->insert(idx, Human::State::Exposed,
+                       random_human_position(0, idx));
       };
 
     const auto insert_recovered_human =
-      [random_human_position, humans = humans.get(),
-       agents_in_position = agents_in_position.get(),
-       inital_index = parameters->human_initial_infected +
-         parameters->human_initial_exposed](auto i) mutable noexcept {
-        const auto idx = inital_index + i;
-        (*humans)[idx] =
-          Human { Human::State::Recovered, idx, random_human_position(idx), 0 };
-        std::get<0>((*agents_in_position)[(*humans)[idx].position])[idx] = idx;
+      [random_human_position, agent_id, humans = humans.get(),
+       inital_index = parameters->human_initial_susceptible +
+         parameters->human_initial_exposed +
+         parameters->human_initial_infected,
+       count = parameters->human_initial_recovered,
+       size = humans_size](auto i) noexcept {
+        const auto idx = agent_id(i, inital_index, count, size);
+        humans->insert(idx, Human::State::Recovered,
+                       random_human_position(0, idx));
       };
 
-    auto random_mosquito_position = util::make_gpu_rng(
-      0UL, environment->size - 1,
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    const auto random_mosquito_position = node(util::make_counter_rng(
+      0UL, environment->size - 1, seed, util::Stream::MosquitoInsertion));
+
+    const auto mosquitos_size = mosquitos->size() / replicas;
 
     const auto insert_susceptible_mosquito =
-      [random_mosquito_position, mosquitos = this->mosquitos.get(),
-       agents_in_position = agents_in_position.get()](unsigned long long i) mutable noexcept {
-        (*mosquitos)[i] = Mosquito { Mosquito::State::Susceptible, i,
-                                     random_mosquito_position(i), 0 };
-        std::get<1>((*agents_in_position)[(*mosquitos)[i].position])[i] = i;
+      [random_mosquito_position, agent_id, mosquitos = this->mosquitos.get(),
+       count = parameters->mosquito_initial_susceptible,
+       size = mosquitos_size](unsigned long long i) noexcept {
+        const auto idx = agent_id(i, 0, count, size);
+        mosquitos->insert(idx, Mosquito::State::Susceptible,
+                          random_mosquito_position(0, idx));
       };
 
     const auto insert_infected_mosquito =
-      [random_mosquito_position, mosquitos = this->mosquitos.get(),
-       agents_in_position = agents_in_position.get(),
-       inital_index =
-         parameters->mosquito_initial_susceptible](auto i) mutable noexcept {
-        const auto idx = inital_index + i;
-        (*mosquitos)[idx] = Mosquito { Mosquito::State::Infected, idx,
-                                       random_mosquito_position(idx), 0 };
-        std::get<1>((*agents_in_position)[(*mosquitos)[idx].position])[idx] =
-          idx;
+      [random_mosquito_position, agent_id, mosquitos = this->mosquitos.get(),
+       inital_index = parameters->mosquito_initial_susceptible,
+       count = parameters->mosquito_initial_infected,
+       size = mosquitos_size](auto i) noexcept {
+        const auto idx = agent_id(i, inital_index, count, size);
+        mosquitos->insert(idx, Mosquito::State::Infected,
+                          random_mosquito_position(0, idx));
       };
 
     const auto insert_recovered_mosquito =
-      [random_mosquito_position, mosquitos = this->mosquitos.get(),
-       agents_in_position = agents_in_position.get(),
+      [random_mosquito_position, agent_id, mosquitos = this->mosquitos.get(),
        inital_index = parameters->mosquito_initial_susceptible +
-         parameters->mosquito_initial_infected](auto i) mutable noexcept {
-        const auto idx = inital_index + i;
-        (*mosquitos)[idx] = Mosquito { Mosquito::State::Recovered, idx,
-                                       random_mosquito_position(idx), 0 };
-        std::get<1>((*agents_in_position)[(*mosquitos)[idx].position])[idx] =
-          idx;
+         parameters->mosquito_initial_infected,
+       count = parameters->mosquito_initial_recovered,
+       size = mosquitos_size](auto i) noexcept {
+        const auto idx = agent_id(i, inital_index, count, size);
+        mosquitos->insert(idx, Mosquito::State::Recovered,
+                          random_mosquito_position(0, idx));
       };
 
-#ifdef SYNC
-    auto range =
-      std::vector<std::size_t>(parameters->human_initial_susceptible);
-    std::iota(std::begin(range), std::end(range), 0UL);
-
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  insert_susceptible_human);
-    range = std::vector<std::size_t>(parameters->human_initial_exposed);
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  insert_exposed_human);
-    range = std::vector<std::size_t>(parameters->human_initial_infected);
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  insert_infected_human);
-    range = std::vector<std::size_t>(parameters->human_initial_recovered);
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  insert_recovered_human);
-    range = std::vector<std::size_t>(parameters->mosquito_initial_susceptible);
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  insert_susceptible_mosquito);
-    range = std::vector<std::size_t>(parameters->mosquito_initial_infected);
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  insert_infected_mosquito);
-    range = std::vector<std::size_t>(parameters->mosquito_initial_recovered);
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  insert_recovered_mosquito);
-#else
-    const auto work = stdexec::when_all(
-      stdexec::just() |
-        exec::on(
-  #ifdef INSERTION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(parameters->human_initial_susceptible,
-                        insert_susceptible_human)),
-      stdexec::just() |
-        exec::on(
-  #ifdef INSERTION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(parameters->human_initial_exposed,
-                        insert_exposed_human)),
-      stdexec::just() |
-        exec::on(
-  #ifdef INSERTION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(parameters->human_initial_infected,
-                        insert_infected_human)),
-      stdexec::just() |
-        exec::on(
-  #ifdef INSERTION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(parameters->human_initial_recovered,
-                        insert_recovered_human)),
-      stdexec::just() |
-        exec::on(
-  #ifdef INSERTION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(parameters->mosquito_initial_susceptible,
-                        insert_susceptible_mosquito)),
-      stdexec::just() |
-        exec::on(
-  #ifdef INSERTION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(parameters->mosquito_initial_infected,
-                        insert_infected_mosquito)),
-      stdexec::just() |
-        exec::on(
-  #ifdef INSERTION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(parameters->mosquito_initial_recovered,
-                        insert_recovered_mosquito)));
-
-    stdexec::sync_wait(std::move(work));
-#endif
-  }
+    launch(
+      execution.insertion,
+      std::make_pair(replicas * parameters->human_initial_susceptible,
+                     insert_susceptible_human),
+      std::make_pair(replicas * parameters->human_initial_exposed,
+                     insert_exposed_human),
+      std::make_pair(replicas * parameters->human_initial_infected,
+                     insert_infected_human),
+      std::make_pair(replicas * parameters->human_initial_recovered,
+                     insert_recovered_human),
+      std::make_pair(replicas * parameters->mosquito_initial_susceptible,
+                     insert_susceptible_mosquito),
+      std::make_pair(replicas * parameters->mosquito_initial_infected,
+                     insert_infected_mosquito),
+      std::make_pair(replicas * parameters->mosquito_initial_recovered,
+                     insert_recovered_mosquito));
 
-  auto Simulation::movement() noexcept -> void {
-    auto random_human_position = util::make_gpu_rng(
-      0UL, environment->size - 1,
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
-
-    const auto human_movement =
-      [random_human_position, environment = environment.get(),
-       humans = humans.get(),
-       agents_in_position = agents_in_position.get()](auto i) mutable noexcept {
-        auto& position = (*humans)[i].position;
-        const auto& edges = environment->edges[position];
-        std::get<0>((*agents_in_position)[position])[i] = -1;
-        position = edges[random_human_position(i) % edges.size()];
-        std::get<0>((*agents_in_position)[position])[i] = i;
-      };
+    reindex();
 
-    auto random_mosquito_position = util::make_gpu_rng(
-      0UL, environment->size - 1,
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    // every replica starts with the initial compartments, the kernels then
+    // only count the state changes
+    counts.clear();
+    for (std::size_t replica = 0; replica < replicas; replica++) {
+      counts.insert(std::end(counts),
+                    { parameters->human_initial_susceptible,
+                      parameters->human_initial_exposed,
+                      parameters->human_initial_infected,
+                      parameters->human_initial_recovered,
+                      parameters->mosquito_initial_susceptible,
+                      parameters->mosquito_initial_infected,
+                      parameters->mosquito_initial_recovered });
+    }
+    flows.assign(replicas * None, 0UL);
+  }
 
-    const auto mosquito_movement =
-      [random_mosquito_position, environment = environment.get(),
-       mosquitos = mosquitos.get(),
-       agents_in_position = agents_in_position.get()](auto i) mutable noexcept {
-        auto& position = (*mosquitos)[i].position;
-        std::get<1>((*agents_in_position)[position])[i] = -1;
-        const auto& edges = environment->edges[position];
-        position = edges[random_mosquito_position(i) % edges.size()];
-        std::get<1>((*agents_in_position)[position])[i] = i;
-      };
+  auto Simulation::reindex() noexcept -> void {
+    humans_in_position->reset(
+      make_cell(humans.get(), environment->size, replicas));
+    mosquitos_in_position->reset(
+      make_cell(mosquitos.get(), environment->size, replicas));
+    frontier->clear();
+    frontier->reset(*humans,
+                    make_cell(humans.get(), environment->size, replicas));
+    frontier->reset(*mosquitos,
+                    make_cell(mosquitos.get(), environment->size, replicas));
+  }
 
-#ifdef SYNC
-    auto range = std::vector<std::size_t>(humans->size());
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  human_movement);
-    range = std::vector<std::size_t>(mosquitos->size());
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  mosquito_movement);
-#else
-    const auto work = stdexec::transfer_when_all(
-  #ifdef MOVEMENT_CPU
-      cpu.get_scheduler()
-  #else
-      gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-        ,
-      stdexec::just() | stdexec::bulk(humans->size(), human_movement),
-      stdexec::just() | stdexec::bulk(mosquitos->size(), mosquito_movement));
-
-    stdexec::sync_wait(std::move(work));
-#endif
+  auto Simulation::movement() noexcept -> void {
+    launch(execution.movement,
+           std::make_pair(humans->size(),
+                          make_movement(environment.get(), humans.get(),
+                                        humans_in_position.get(),
+                                        frontier.get(),
+                                        util::Stream::HumanMovement, replicas,
+                                        seed, iteration)),
+           std::make_pair(mosquitos->size(),
+                          make_movement(environment.get(), mosquitos.get(),
+                                        mosquitos_in_position.get(),
+                                        frontier.get(),
+                                        util::Stream::MosquitoMovement,
+                                        replicas, seed, iteration)));
+
+    // arrivals and departures were counted by the movement kernels, only the
+    // agents ids are scattered here
+    humans_in_position->rebuild(
+      make_cell(humans.get(), environment->size, replicas));
+    mosquitos_in_position->rebuild(
+      make_cell(mosquitos.get(), environment->size, replicas));
   }
 
   auto Simulation::contact() noexcept -> void {
-    auto agents_set = std::make_unique<std::vector<
-      std::pair<std::vector<std::int64_t>, std::vector<std::int64_t>>>>(
-      environment->size);
-
-    auto generate_agents_in_position =
-      [agents_set = agents_set.get(),
-       agents_in_position = agents_in_position.get()](auto i) mutable {
-        std::copy_if(std::execution::seq,
-                     std::begin(std::get<0>((*agents_in_position)[i])),
-                     std::end(std::get<0>((*agents_in_position)[i])),
-                     std::back_inserter(std::get<0>((*agents_set)[i])),
-                     [](auto a) { return a != -1; });
-
-        std::copy_if(std::execution::seq,
-                     std::begin(std::get<1>((*agents_in_position)[i])),
-                     std::end(std::get<1>((*agents_in_position)[i])),
-                     std::back_inserter(std::get<1>((*agents_set)[i])),
-                     [](auto a) { return a != -1; });
-      };
+    const auto random_human_probability =
+      util::make_counter_rng(0.0, 1.0, seed, util::Stream::HumanContact);
+    const auto random_mosquito_probability =
+      util::make_counter_rng(0.0, 1.0, seed, util::Stream::MosquitoContact);
+    const auto random_mosquito_mosquito_probability = util::make_counter_rng(
+      0.0, 1.0, seed, util::Stream::MosquitoMosquitoContact);
 
-    auto random_probability = util::make_gpu_rng(
-      0.0, 1.0,
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    // the infections of a cell are added to the flows of its replica and
+    // to the frontier counts once per cell
+    const auto infect = [flows = flows.data(), frontier = frontier.get(),
+                         size = environment->size](auto i, auto exposed,
+                                                   auto infected) noexcept {
+      if (exposed != 0) {
+        std::atomic_ref(flows[i / size * None + HumanExposed])
+          .fetch_add(exposed, std::memory_order_relaxed);
+        frontier->remove(Frontier::SusceptibleHumans, i, exposed);
+      }
+      if (infected != 0) {
+        std::atomic_ref(flows[i / size * None + MosquitoInfected])
+          .fetch_add(infected, std::memory_order_relaxed);
+        frontier->remove(Frontier::SusceptibleMosquitos, i, infected);
+        frontier->add(Frontier::InfectiousMosquitos, i, infected);
+      }
+    };
 
-    const auto human_mosquito_contact =
-      [random_probability, environment = environment.get(),
+    // the agents of a cell read the states of the cycle and write their
+    // next state, so the cell does not depend on the order of its agents
+    const auto pairwise_contact =
+      [random_human_probability, random_mosquito_probability,
+       random_mosquito_mosquito_probability, infect, iteration = iteration,
        parameters = parameters.get(), humans = humans.get(),
        mosquitos = mosquitos.get(),
-       agents_in_position = agents_set.get()](auto i) mutable noexcept {
-        auto& humans_in_pos = std::get<0>((*agents_in_position)[i]);
-        auto& mosquitos_in_pos = std::get<1>((*agents_in_position)[i]);
+       humans_in_position = humans_in_position.get(),
+       mosquitos_in_position =
+         mosquitos_in_position.get()](auto i) noexcept {
+        const auto humans_in_pos = humans_in_position->in(i);
+        const auto mosquitos_in_pos = mosquitos_in_position->in(i);
+
+        auto exposed = std::size_t { 0 };
         for (const auto& human_id : humans_in_pos) {
-          for (const auto& mosquito_id : mosquitos_in_pos) {
-            auto& human = (*humans)[human_id];
-            auto& mosquito = (*mosquitos)[mosquito_id];
-
-            if (human.state == Human::State::Susceptible &&
-                mosquito.state == Mosquito::State::Infected &&
-                random_probability(human_id) <
-                  parameters->human_infection_rate) {
-              human.state = Human::State::Exposed;
-            } else if (human.state == Human::State::Infected &&
-                       mosquito.state == Mosquito::State::Susceptible &&
-                       random_probability(mosquito_id) <
-                         parameters->mosquito_infection_rate) {
-              mosquito.state = Mosquito::State::Infected;
-            }
+          auto state = humans->states[human_id];
+          if (state == Human::State::Susceptible &&
+              infected_by(iteration, humans->id(human_id), mosquitos_in_pos,
+                          *mosquitos, Mosquito::State::Infected,
+                          random_human_probability,
+                          parameters->human_infection_rate)) {
+            state = Human::State::Exposed;
+            humans->changes[human_id] |= Population<Human>::StateChanged;
+            exposed++;
+          }
+          humans->next_states[human_id] = state;
+        }
+
+        auto infected = std::size_t { 0 };
+        for (const auto& mosquito_id : mosquitos_in_pos) {
+          auto state = mosquitos->states[mosquito_id];
+          if (state == Mosquito::State::Susceptible &&
+              (infected_by(iteration, mosquitos->id(mosquito_id),
+                           humans_in_pos, *humans, Human::State::Infected,
+                           random_mosquito_probability,
+                           parameters->mosquito_infection_rate) ||
+               infected_by(iteration, mosquitos->id(mosquito_id),
+                           mosquitos_in_pos, *mosquitos,
+                           Mosquito::State::Infected,
+                           random_mosquito_mosquito_probability,
+                           parameters->mosquito_infection_rate))) {
+            state = Mosquito::State::Infected;
+            mosquitos->changes[mosquito_id] |=
+              Population<Mosquito>::StateChanged;
+            infected++;
           }
+          mosquitos->next_states[mosquito_id] = state;
         }
+
+        infect(i, exposed, infected);
       };
 
-    const auto mosquito_mosquito_contact =
-      [random_probability, mosquitos = mosquitos.get(),
-       parameters = parameters.get(),
-       agents_in_position = agents_set.get()](auto i) mutable noexcept {
-        auto& mosquitos_in_pos = std::get<1>((*agents_in_position)[i]);
+    const auto random_human_pressure =
+      util::make_counter_rng(0.0, 1.0, seed, util::Stream::HumanPressure);
+    const auto random_mosquito_pressure =
+      util::make_counter_rng(0.0, 1.0, seed, util::Stream::MosquitoPressure);
+
+    // a single draw per susceptible against the infectious agents of its
+    // cell, a.k.a. `1 - (1 - p)^k` with `k` infectious agents
+    const auto pressure_contact =
+      [random_human_pressure, random_mosquito_pressure, infect,
+       iteration = iteration, parameters = parameters.get(),
+       humans = humans.get(), mosquitos = mosquitos.get(),
+       humans_in_position = humans_in_position.get(),
+       mosquitos_in_position =
+         mosquitos_in_position.get()](auto i) noexcept {
+        const auto humans_in_pos = humans_in_position->in(i);
+        const auto mosquitos_in_pos = mosquitos_in_position->in(i);
+
+        auto infectious_humans = std::size_t { 0 };
+        auto infectious_mosquitos = std::size_t { 0 };
+        for (const auto& human_id : humans_in_pos) {
+          infectious_humans +=
+            humans->states[human_id] == Human::State::Infected ? 1 : 0;
+        }
+        for (const auto& mosquito_id : mosquitos_in_pos) {
+          infectious_mosquitos +=
+            mosquitos->states[mosquito_id] == Mosquito::State::Infected ? 1
+                                                                        : 0;
+        }
+        const auto human_probability =
+          1.0 -
+          std::pow(1.0 - parameters->human_infection_rate,
+                   static_cast<double>(infectious_mosquitos));
+        const auto mosquito_probability =
+          1.0 -
+          std::pow(1.0 - parameters->mosquito_infection_rate,
+                   static_cast<double>(infectious_humans +
+                                       infectious_mosquitos));
+
+        auto exposed = std::size_t { 0 };
+        for (const auto& human_id : humans_in_pos) {
+          auto state = humans->states[human_id];
+          if (state == Human::State::Susceptible && infectious_mosquitos != 0 &&
+              random_human_pressure(iteration, humans->id(human_id)) <
+                human_probability) {
+            state = Human::State::Exposed;
+            humans->changes[human_id] |= Population<Human>::StateChanged;
+            exposed++;
+          }
+          humans->next_states[human_id] = state;
+        }
+
+        auto infected = std::size_t { 0 };
         for (const auto& mosquito_id : mosquitos_in_pos) {
-          for (const auto& mosquito_id2 : mosquitos_in_pos) {
-            if (mosquito_id != mosquito_id2) {
-              auto& mosquito = (*mosquitos)[mosquito_id];
-              auto& mosquito2 = (*mosquitos)[mosquito_id2];
-              if (mosquito.state == Mosquito::State::Infected &&
-                  mosquito2.state == Mosquito::State::Susceptible &&
-                  random_probability(mosquito.id) <
-                    parameters->mosquito_infection_rate) {
-                mosquito2.state = Mosquito::State::Infected;
-              } else if (mosquito.state == Mosquito::State::Susceptible &&
-                         mosquito2.state == Mosquito::State::Infected &&
-                         random_probability(mosquito2.id) <
-                           parameters->mosquito_infection_rate) {
-                mosquito.state = Mosquito::State::Infected;
-              }
-            }
+          auto state = mosquitos->states[mosquito_id];
+          if (state == Mosquito::State::Susceptible &&
+              infectious_humans + infectious_mosquitos != 0 &&
+              random_mosquito_pressure(iteration, mosquitos->id(mosquito_id)) <
+                mosquito_probability) {
+            state = Mosquito::State::Infected;
+            mosquitos->changes[mosquito_id] |=
+              Population<Mosquito>::StateChanged;
+            infected++;
           }
+          mosquitos->next_states[mosquito_id] = state;
         }
+
+        infect(i, exposed, infected);
       };
 
-    const auto work1 = stdexec::just() |
-      exec::on(cpu.get_scheduler(),
-               stdexec::bulk(environment->size, generate_agents_in_position));
+    // the next states of the agents of a cell become their states
+    const auto commit = [humans = humans.get(), mosquitos = mosquitos.get(),
+                         humans_in_position = humans_in_position.get(),
+                         mosquitos_in_position =
+                           mosquitos_in_position.get()](auto i) noexcept {
+      for (const auto& human_id : humans_in_position->in(i)) {
+        humans->states[human_id] = humans->next_states[human_id];
+      }
+      for (const auto& mosquito_id : mosquitos_in_position->in(i)) {
+        mosquitos->states[mosquito_id] = mosquitos->next_states[mosquito_id];
+      }
+    };
 
-    stdexec::sync_wait(std::move(work1));
+    // only the cells where a transmission is possible, of every replica
+    const auto active = frontier->update();
+    const auto over = [active = active.data()](auto kernel) noexcept {
+      return [active, kernel](auto k) noexcept { kernel(active[k]); };
+    };
 
-#ifdef SYNC
-    auto range = std::vector<std::size_t>(environment->size);
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  human_mosquito_contact);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  mosquito_mosquito_contact);
-#else
-    const auto work2 = stdexec::when_all(
-      stdexec::just() |
-        exec::on(
-  #ifdef CONTACT_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(environment->size, human_mosquito_contact)),
-      stdexec::just() |
-        exec::on(
-  #ifdef CONTACT_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(environment->size, mosquito_mosquito_contact)));
-
-    stdexec::sync_wait(std::move(work2));
-#endif
+    if (execution.aggregated) {
+      launch(execution.contact,
+             std::make_pair(active.size(), over(pressure_contact)));
+    } else {
+      launch(execution.contact,
+             std::make_pair(active.size(), over(pairwise_contact)));
+    }
+    launch(execution.contact, std::make_pair(active.size(), over(commit)));
   }
 
   auto Simulation::transition() noexcept -> void {
-    const auto human_transition = [=, humans = humans.get(),
-                                   parameters =
-                                     parameters.get()](auto i) noexcept {
-      auto& human = (*humans)[i];
+    launch(execution.transition,
+           make_counted(humans.get(),
+                        make_transition(humans.get(), parameters.get(),
+                                        frontier.get(), environment->size,
+                                        replicas),
+                        replicas, flows.data(), execution.transition),
+           make_counted(mosquitos.get(),
+                        make_transition(mosquitos.get(), parameters.get(),
+                                        frontier.get(), environment->size,
+                                        replicas),
+                        replicas, flows.data(), execution.transition));
+  }
 
-      switch (human.state) {
-        case Human::State::Exposed:
-          if (human.counter >= parameters->human_transition_period_exposed) {
-            human.state = Human::State::Infected;
-            human.counter = 0;
-          } else {
-            human.counter++;
-          }
-          break;
-        case Human::State::Infected:
-          if (human.counter >= parameters->human_transition_period_infected) {
-            human.state = Human::State::Recovered;
-            human.counter = 0;
-          } else {
-            human.counter++;
-          }
-          break;
-        case Human::State::Recovered:
-          if (human.counter >= parameters->human_transition_period_recovered) {
-            human.state = Human::State::Susceptible;
-            human.counter = 0;
-          } else {
-            human.counter++;
-          }
-          break;
-        case Human::State::Susceptible:
-          human.counter++;
-          break;
-      }
+  auto Simulation::fused() noexcept -> void {
+    // the positions of the next cycle are written aside, so the sink still
+    // records the positions of this cycle
+    const auto move = iteration + 1 < parameters->cycles;
+    const auto fuse = [move](auto transition, auto movement) noexcept {
+      return [transition, movement, move](auto i) noexcept {
+        const auto flow = transition(i);
+        if (move) {
+          movement(i);
+        }
+        return flow;
+      };
     };
 
-    const auto mosquito_transition = [=, mosquitos = mosquitos.get(),
-                                      parameters =
-                                        parameters.get()](auto i) noexcept {
-      auto& mosquito = (*mosquitos)[i];
+    launch(
+      execution.transition,
+      make_counted(
+        humans.get(),
+        fuse(make_transition(humans.get(), parameters.get(), frontier.get(),
+                             environment->size, replicas),
+             make_movement(environment.get(), humans.get(),
+                           humans_in_position.get(), frontier.get(),
+                           util::Stream::HumanMovement, replicas, seed,
+                           iteration + 1, humans->next_positions.data(),
+                           Population<Human>::NextPositionChanged)),
+        replicas, flows.data(), execution.transition),
+      make_counted(
+        mosquitos.get(),
+        fuse(make_transition(mosquitos.get(), parameters.get(),
+                             frontier.get(), environment->size, replicas),
+             make_movement(environment.get(), mosquitos.get(),
+                           mosquitos_in_position.get(), frontier.get(),
+                           util::Stream::MosquitoMovement, replicas, seed,
+                           iteration + 1, mosquitos->next_positions.data(),
+                           Population<Mosquito>::NextPositionChanged)),
+        replicas, flows.data(), execution.transition));
+  }
 
-      switch (mosquito.state) {
-        case Mosquito::State::Infected:
-          if (mosquito.counter >=
-              parameters->mosquito_transition_period_infected) {
-            mosquito.state = Mosquito::State::Recovered;
-            mosquito.counter = 0;
-          } else {
-            mosquito.counter++;
-          }
-          break;
-        case Mosquito::State::Recovered:
-          if (mosquito.counter >=
-              parameters->mosquito_transition_period_recovered) {
-            mosquito.state = Mosquito::State::Susceptible;
-            mosquito.counter = 0;
-          } else {
-            mosquito.counter++;
-          }
-          break;
-        case Mosquito::State::Susceptible:
-          mosquito.counter++;
-          break;
+  auto Simulation::sort() noexcept -> void {
+    // a stable sort by cell, so the agents of a cell stay in slot order and
+    // the replicas in their own range of slots
+    const auto by_cell = [this](auto& population) {
+      const auto cell = make_cell(&population, environment->size, replicas);
+      auto order = std::vector<std::size_t>(population.size());
+      std::iota(std::begin(order), std::end(order), 0UL);
+      std::stable_sort(std::execution::par, std::begin(order), std::end(order),
+                       [cell](auto a, auto b) { return cell(a) < cell(b); });
+      population.permute(order);
+
+      // the permuted columns were allocated by this thread
+      if (!nodes.empty()) {
+        place(population.states);
+        place(population.positions);
+        place(population.counters);
+        place(population.changes);
+        place(population.ids);
+        place(population.slots);
       }
     };
 
-#ifdef SYNC
-    auto range = std::vector<std::size_t>(humans->size());
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  human_transition);
+    // the cells keep their counts, the occupancies are rebuilt with the new
+    // slots after the next movement
+    by_cell(*humans);
+    by_cell(*mosquitos);
+  }
 
-    range = std::vector<std::size_t>(mosquitos->size());
-    std::iota(std::begin(range), std::end(range), 0UL);
-    std::for_each(std::execution::par_unseq, std::begin(range), std::end(range),
-                  mosquito_transition);
-#else
-    const auto work = stdexec::when_all(
-      stdexec::just() |
-        exec::on(
-  #ifdef TRANSITION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(humans->size(), human_transition)),
-      stdexec::just() |
-        exec::on(
-  #ifdef TRANSITION_CPU
-          cpu.get_scheduler()
-  #else
-          gpu.get_scheduler(nvexec::stream_priority::high)
-  #endif
-            ,
-          stdexec::bulk(mosquitos->size(), mosquito_transition)));
-
-    stdexec::sync_wait(std::move(work));
-#endif
+  template <typename Agent>
+  auto Simulation::recorded(const Population<Agent>& population,
+                            Population<Agent>& ordered) const
+    -> const Population<Agent>& {
+    // the sink does not read the agents of the cycle, whatever their order
+    if (population.ids.empty() || !sink->records_agents(iteration)) {
+      return population;
+    }
+    population.unpermute(ordered);
+    return ordered;
   }
 
-  auto Simulation::output() noexcept -> const State& {
-    auto humans_in_states = std::transform_reduce(
-      std::execution::par_unseq, std::begin(*humans), std::end(*humans),
-      std::make_tuple<std::size_t, std::size_t, std::size_t, std::size_t>(
-        0L, 0L, 0L, 0L),
-      [](const auto& seir1, const auto& seir2) {
-        return std::make_tuple<std::size_t, std::size_t, std::size_t,
-                               std::size_t>(
-          std::get<0>(seir1) + std::get<0>(seir2),
-          std::get<1>(seir1) + std::get<1>(seir2),
-          std::get<2>(seir1) + std::get<2>(seir2),
-          std::get<3>(seir1) + std::get<3>(seir2));
-      },
-      [](const auto& human) {
-        return std::make_tuple<std::size_t, std::size_t, std::size_t,
-                               std::size_t>(
-          human.state == Human::State::Susceptible ? 1 : 0,
-          human.state == Human::State::Exposed ? 1 : 0,
-          human.state == Human::State::Infected ? 1 : 0,
-          human.state == Human::State::Recovered ? 1 : 0);
-      });
+  auto Simulation::output() -> const State& {
+    ++iteration;
+
+    // sorted populations are recorded in id order
+    const auto& recorded_humans = recorded(*humans, *ordered_humans);
+    const auto& recorded_mosquitos = recorded(*mosquitos, *ordered_mosquitos);
 
-    auto mosquitos_in_states = std::transform_reduce(
-      std::execution::par_unseq, std::begin(*mosquitos), std::end(*mosquitos),
-      std::make_tuple<std::size_t, std::size_t, std::size_t>(0L, 0L, 0L),
-      [](const auto& sir1, const auto& sir2) {
-        return std::make_tuple<std::size_t, std::size_t, std::size_t>(
-          std::get<0>(sir1) + std::get<0>(sir2),
-          std::get<1>(sir1) + std::get<1>(sir2),
-          std::get<2>(sir1) + std::get<2>(sir2));
-      },
-      [](const auto& mosquito) {
-        return std::make_tuple<std::size_t, std::size_t, std::size_t>(
-          mosquito.state == Mosquito::State::Susceptible ? 1 : 0,
-          mosquito.state == Mosquito::State::Infected ? 1 : 0,
-          mosquito.state == Mosquito::State::Recovered ? 1 : 0);
+    for (std::size_t replica = 0; replica < replicas; replica++) {
+      // the flows of the cycle move the agents between the compartments,
+      // wrapping around is fine as the counts never go negative
+      auto* count = counts.data() + replica * compartments;
+      auto* flow = flows.data() + replica * None;
+      count[0] += flow[HumanSusceptible] - flow[HumanExposed];
+      count[1] += flow[HumanExposed] - flow[HumanInfected];
+      count[2] += flow[HumanInfected] - flow[HumanRecovered];
+      count[3] += flow[HumanRecovered] - flow[HumanSusceptible];
+      count[4] += flow[MosquitoSusceptible] - flow[MosquitoInfected];
+      count[5] += flow[MosquitoInfected] - flow[MosquitoRecovered];
+      count[6] += flow[MosquitoRecovered] - flow[MosquitoSusceptible];
+
+      auto& states = (*this->states)[replica];
+      states.push_back({
+        { iteration, parameters->cycles },
+        { count[0], count[1], count[2], count[3] },
+        { count[4], count[5], count[6] },
+        { flow[HumanExposed], flow[MosquitoInfected] },
+        {},
+        {},
       });
+      sink->record(states.back(), recorded_humans, recorded_mosquitos);
+    }
+    std::fill(std::begin(flows), std::end(flows), 0UL);
 
-    states->push_back({
-      { ++iteration, parameters->cycles },
-      humans_in_states,
-      mosquitos_in_states,
-    });
+    // the fused pass already moved the agents of the next cycle aside
+    if (execution.fused && iteration < parameters->cycles) {
+      humans->positions.swap(humans->next_positions);
+      mosquitos->positions.swap(mosquitos->next_positions);
+    }
 
-    // copy all humans to the states
-    std::copy(std::begin(*humans), std::end(*humans),
-              std::back_inserter(states->back().humans));
-    std::copy(std::begin(*mosquitos), std::end(*mosquitos),
-              std::back_inserter(states->back().mosquitos));
+    // only the moves of the next cycle are kept
+    std::transform(std::execution::par_unseq, std::begin(humans->changes),
+                   std::end(humans->changes), std::begin(humans->changes),
+                   [](auto change) noexcept -> std::uint8_t {
+                     return (change & Population<Human>::NextPositionChanged)
+                       ? Population<Human>::PositionChanged
+                       : Population<Human>::Unchanged;
+                   });
+    std::transform(std::execution::par_unseq, std::begin(mosquitos->changes),
+                   std::end(mosquitos->changes),
+                   std::begin(mosquitos->changes),
+                   [](auto change) noexcept -> std::uint8_t {
+                     return (change &
+                             Population<Mosquito>::NextPositionChanged)
+                       ? Population<Mosquito>::PositionChanged
+                       : Population<Mosquito>::Unchanged;
+                   });
+
+    if (checkpoints && iteration % checkpoint_interval == 0 &&
+        iteration < parameters->cycles) {
+      // the results hold every cycle of a checkpoint before it is saved
+      sink->flush();
+      checkpoints->write(snapshot());
+    }
+
+    return states->front().back();
+  }
+
+  auto Simulation::snapshot() const -> std::unique_ptr<const Checkpoint> {
+    auto checkpoint = std::make_unique<Checkpoint>();
+    checkpoint->header = {
+      Checkpoint::magic,
+      Checkpoint::version,
+      humans->ids.empty() ? 0U : 1U,
+      iteration,
+      seed,
+      replicas,
+      environment->hash,
+      humans->size(),
+      mosquitos->size(),
+    };
+
+    // the fused pass already moved the agents, their positions of this cycle
+    // were swapped to the next positions
+    const auto copy = [this](const auto& population, auto& to) {
+      const auto& positions =
+        execution.fused ? population.next_positions : population.positions;
+      to.states = population.states;
+      to.counters = population.counters;
+      to.ids = population.ids;
+      to.positions.resize(positions.size());
+      std::transform(std::execution::par_unseq, std::begin(positions),
+                     std::end(positions), std::begin(to.positions),
+                     [environment = environment.get()](auto position) {
+                       return environment->input(position);
+                     });
+    };
+    copy(*humans, checkpoint->humans);
+    copy(*mosquitos, checkpoint->mosquitos);
+
+    checkpoint->counts = counts;
+    for (const auto& replica : *states) {
+      auto& counts = checkpoint->states.emplace_back();
+      counts.reserve(replica.size());
+      for (const auto& state : replica) {
+        const auto [humans_s, humans_e, humans_i, humans_r] =
+          state.humans_in_states;
+        const auto [mosquitos_s, mosquitos_i, mosquitos_r] =
+          state.mosquitos_in_states;
+        counts.push_back({
+          state.progress.first,
+          { humans_s, humans_e, humans_i, humans_r },
+          { mosquitos_s, mosquitos_i, mosquitos_r },
+          { state.incidence.first, state.incidence.second },
+        });
+      }
+    }
+    return checkpoint;
+  }
+
+  auto Simulation::checkpoint(const std::filesystem::path& path,
+                              std::size_t every) -> void {
+    checkpoints = every != 0 ? std::make_unique<CheckpointWriter>(path)
+                             : nullptr;
+    checkpoint_interval = every;
+  }
+
+  auto Simulation::resume(const std::filesystem::path& path) -> void {
+    auto checkpoint = Checkpoint::load(path);
+    const auto& header = checkpoint.header;
+    if (header.seed != seed || header.replicas != replicas ||
+        header.environment != environment->hash ||
+        header.humans != humans->size() ||
+        header.mosquitos != mosquitos->size() ||
+        header.iteration > parameters->cycles) {
+      throw std::invalid_argument("checkpoint of another simulation: " +
+                                  path.string());
+    }
+
+    const auto restore = [this](auto& checkpointed, auto& population) {
+      population.states.swap(checkpointed.states);
+      population.counters.swap(checkpointed.counters);
+      population.ids.swap(checkpointed.ids);
+      population.slots.resize(population.ids.size());
+      for (std::size_t slot = 0; slot < population.ids.size(); slot++) {
+        population.slots[population.ids[slot]] =
+          static_cast<std::uint32_t>(slot);
+      }
+      std::fill(std::begin(population.changes),
+                std::end(population.changes), 0);
+      std::transform(std::execution::par_unseq,
+                     std::begin(checkpointed.positions),
+                     std::end(checkpointed.positions),
+                     std::begin(population.positions),
+                     [environment = environment.get()](auto input) {
+                       return environment->node(input);
+                     });
+
+      if (!nodes.empty()) {
+        place(population.states);
+        place(population.positions);
+        place(population.counters);
+        place(population.changes);
+        place(population.ids);
+        place(population.slots);
+      }
+    };
+    restore(checkpoint.humans, *humans);
+    restore(checkpoint.mosquitos, *mosquitos);
+    reindex();
+
+    counts = checkpoint.counts;
+    flows.assign(replicas * None, 0UL);
+    for (std::size_t replica = 0; replica < replicas; replica++) {
+      auto& states = (*this->states)[replica];
+      states.clear();
+      for (const auto& counts : checkpoint.states[replica]) {
+        states.push_back({
+          { counts.cycle, parameters->cycles },
+          { counts.humans[0], counts.humans[1], counts.humans[2],
+            counts.humans[3] },
+          { counts.mosquitos[0], counts.mosquitos[1], counts.mosquitos[2] },
+          { counts.incidence[0], counts.incidence[1] },
+          {},
+          {},
+        });
+      }
+    }
 
-    return states->back();
+    iteration = header.iteration;
+    resumed = header.iteration;
   }
 
-  auto Simulation::get_states() noexcept -> const std::vector<State>& {
-    return *states;
+  auto Simulation::get_states(std::size_t replica) noexcept
+    -> const std::vector<State>& {
+    return (*states)[replica];
   }
 
 } // namespace simulator
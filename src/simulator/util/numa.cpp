@@ -0,0 +1,125 @@
+#include <simulator/util/numa.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace simulator::util {
+  namespace {
+    /**
+     * @brief Cpus the calling thread is allowed on
+     */
+    auto allowed() -> std::vector<unsigned> {
+      auto set = cpu_set_t {};
+      CPU_ZERO(&set);
+      if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "cannot get the cpu affinity");
+      }
+
+      auto cpus = std::vector<unsigned>();
+      for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+          cpus.push_back(cpu);
+        }
+      }
+      return cpus;
+    }
+
+    /**
+     * @brief Parse a sysfs cpu list, e.g. `0-15,32-47`
+     */
+    auto parse_cpulist(const std::string& list) -> std::vector<unsigned> {
+      auto cpus = std::vector<unsigned>();
+      auto stream = std::istringstream(list);
+      for (auto range = std::string(); std::getline(stream, range, ',');) {
+        if (range.empty() || range == "\n") {
+          continue;
+        }
+        const auto dash = range.find('-');
+        const auto first = static_cast<unsigned>(std::stoul(range));
+        const auto last = dash == std::string::npos
+          ? first
+          : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+        for (auto cpu = first; cpu <= last; cpu++) {
+          cpus.push_back(cpu);
+        }
+      }
+      return cpus;
+    }
+  } // namespace
+
+  auto Topology::detect() -> Topology {
+    const auto cpus = allowed();
+    const auto root = std::filesystem::path("/sys/devices/system/node");
+
+    // the node ids may have gaps, e.g. after a node is taken offline
+    auto ids = std::vector<unsigned>();
+    auto error = std::error_code();
+    for (const auto& entry :
+         std::filesystem::directory_iterator(root, error)) {
+      const auto name = entry.path().filename().string();
+      if (name.size() > 4 && name.starts_with("node") &&
+          std::all_of(std::begin(name) + 4, std::end(name),
+                      [](char c) { return c >= '0' && c <= '9'; })) {
+        ids.push_back(static_cast<unsigned>(std::stoul(name.substr(4))));
+      }
+    }
+    std::ranges::sort(ids);
+
+    auto topology = Topology {};
+    for (const auto id : ids) {
+      auto list = std::string();
+      std::getline(
+        std::ifstream(root / ("node" + std::to_string(id)) / "cpulist"), list);
+      auto in_node = std::vector<unsigned>();
+      for (const auto cpu : parse_cpulist(list)) {
+        if (std::binary_search(std::begin(cpus), std::end(cpus), cpu)) {
+          in_node.push_back(cpu);
+        }
+      }
+      if (!in_node.empty()) {
+        topology.nodes.push_back(std::move(in_node));
+      }
+    }
+
+    if (topology.nodes.empty()) {
+      topology.nodes.push_back(cpus);
+    }
+    return topology;
+  }
+
+  auto bind(std::span<const unsigned> cpus) -> std::vector<unsigned> {
+    auto previous = allowed();
+
+    auto set = cpu_set_t {};
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) {
+      CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "cannot set the cpu affinity");
+    }
+    return previous;
+  }
+
+  auto release(void* data, std::size_t bytes) noexcept -> void {
+    const auto page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto begin = reinterpret_cast<std::uintptr_t>(data);
+    const auto first = (begin + page - 1) / page * page;
+    const auto last = (begin + bytes) / page * page;
+    if (first < last) {
+      madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+  }
+} // namespace simulator::util
@@ -1,20 +1,36 @@
 #include "indicators/setting.hpp"
 #include <memory>
+#include <simulator/checkpoint.hpp>
+#include <simulator/distributed/communicator.hpp>
+#include <simulator/distributed/simulation.hpp>
 #include <simulator/environment.hpp>
+#include <simulator/execution.hpp>
+#include <simulator/monte_carlo.hpp>
 #include <simulator/parameters.hpp>
+#include <simulator/output/history.hpp>
+#include <simulator/output/results.hpp>
+#include <simulator/output/pipeline.hpp>
+#include <simulator/output/sink.hpp>
 #include <simulator/simulation.hpp>
 #include <simulator/util/random.hpp>
 
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <argparse/argparse.hpp>
 #include <indicators/dynamic_progress.hpp>
 #include <indicators/progress_bar.hpp>
+#ifdef SIMULATOR_MPI
+  #include <mpi.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -31,37 +47,335 @@ auto main(int argc, char* argv[]) -> int {
     .default_value(std::string("./assets/output"))
     .action([](const std::string& value) -> fs::path { return value; });
 
+  program.add_argument("-s", "--seed")
+    .help("Master seed, runs with the same seed are reproducible")
+    .action([](const std::string& value) -> std::uint64_t {
+      return std::stoull(value);
+    });
+
+  program.add_argument("-m", "--output-mode")
+    .help("Agents recorded each cycle: aggregate, snapshot, cohort, full or "
+          "history")
+    .default_value(std::string("full"))
+    .choices("aggregate", "snapshot", "cohort", "full", "history");
+
+  program.add_argument("--every")
+    .help("Cycles between snapshots in snapshot mode, or between keyframes "
+          "in history mode")
+    .default_value(1UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("-f", "--format")
+    .help("Results format: json, or binary (see simulator/output/results.hpp)")
+    .default_value(std::string("json"))
+    .choices("json", "binary");
+
+  program.add_argument("--cohort")
+    .help("Number of humans and mosquitos followed in cohort mode")
+    .default_value(100UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("-j", "--jobs")
+    .help("Replicas run at once when the parameters have more than one run")
+    .default_value(
+      static_cast<std::size_t>(std::thread::hardware_concurrency()))
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("--pipeline")
+    .help("Record the agents on a worker thread while the next cycles run")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--fused")
+    .help("Fuse the transition, counting and next movement in one pass")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--aggregated")
+    .help("Use the aggregated infection pressure of each cell for contact")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--sort-every")
+    .help("Cycles between sorts of the agents by cell, 0 to never sort")
+    .default_value(0UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+#ifdef SIMULATOR_HOST_ONLY
+  // the gpu build allocates the columns in managed memory
+  program.add_argument("--numa")
+    .help("Run the cpu phases on one pinned pool per NUMA node")
+    .default_value(false)
+    .implicit_value(true);
+#endif
+
+  program.add_argument("--checkpoint-every")
+    .help("Cycles between checkpoints of each simulation, 0 to never save one")
+    .default_value(0UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+  program.add_argument("--resume")
+    .help("Continue each simulation from its checkpoint, when it has one, "
+          "with the seed of the checkpoint unless --seed is given")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--ordering")
+    .help("Numbering of the environment nodes: input, rcm or hilbert")
+    .default_value(std::string("input"))
+    .choices("input", "rcm", "hilbert");
+
+  program.add_argument("--ranks")
+    .help("Local processes splitting the environment between them, over "
+          "shared memory")
+    .default_value(1UL)
+    .action([](const std::string& value) -> std::size_t {
+      return std::stoul(value);
+    });
+
+#ifdef SIMULATOR_MPI
+  program.add_argument("--mpi")
+    .help("Split the environment between the ranks of the MPI job")
+    .default_value(false)
+    .implicit_value(true);
+#endif
+
+  program.add_argument("-e", "--execution")
+    .help("Placement of every phase: sync, cpu or gpu")
+    .default_value(std::string("gpu"))
+    .choices("sync", "cpu", "gpu");
+
+  for (const auto* phase :
+       { "--insertion", "--movement", "--contact", "--transition" }) {
+    program.add_argument(phase)
+      .help("Placement of the phase, overrides --execution")
+      .choices("sync", "cpu", "gpu");
+  }
+
   try {
     program.parse_args(argc, argv);
 
     const auto input_path = program.get<std::string>("--input");
     const auto output_path = program.get<std::string>("--output");
+    const auto seed = program.present<std::uint64_t>("--seed");
+    const auto output_mode = program.get<std::string>("--output-mode");
+    const auto every = program.get<std::size_t>("--every");
+    const auto cohort = program.get<std::size_t>("--cohort");
+    const auto format = program.get<std::string>("--format");
+    const auto pipeline = program.get<bool>("--pipeline");
+
+    const auto pipelined = [pipeline](
+                             std::shared_ptr<simulator::output::Sink> sink)
+      -> std::shared_ptr<simulator::output::Sink> {
+      if (!pipeline) {
+        return sink;
+      }
+      return std::make_shared<simulator::output::PipelinedSink>(
+        std::move(sink));
+    };
+    const auto jobs = program.get<std::size_t>("--jobs");
+    auto execution = simulator::Execution::from_strings(
+      program.get<std::string>("--execution"), program.present("--insertion"),
+      program.present("--movement"), program.present("--contact"),
+      program.present("--transition"));
+    execution.fused = program.get<bool>("--fused");
+    execution.aggregated = program.get<bool>("--aggregated");
+    execution.sort_interval = program.get<std::size_t>("--sort-every");
+#ifdef SIMULATOR_HOST_ONLY
+    execution.numa = program.get<bool>("--numa");
+#endif
+    const auto checkpoint_every =
+      program.get<std::size_t>("--checkpoint-every");
+    const auto resume = program.get<bool>("--resume");
+    // a history is keyed by the cycles from the first one on
+    if (output_mode == "history" && (checkpoint_every != 0 || resume)) {
+      throw std::invalid_argument("a history is recorded without checkpoints");
+    }
+    const auto ordering =
+      simulator::parse_ordering(program.get<std::string>("--ordering"));
+    const auto ranks = program.get<std::size_t>("--ranks");
+#ifdef SIMULATOR_MPI
+    const auto mpi = program.get<bool>("--mpi");
+    if (mpi) {
+      MPI_Init(&argc, &argv);
+    }
+#else
+    const auto mpi = false;
+#endif
 
     for (fs::path simulation_path : fs::directory_iterator(input_path)) {
-      auto environment_input_file =
-        std::ifstream { simulation_path / "environment.json" };
       auto parameters_input_file =
         std::ifstream { simulation_path / "parameters.json" };
 
-      const auto environment_data =
-        std::string { std::istreambuf_iterator<char> { environment_input_file },
-                      std::istreambuf_iterator<char> {} };
       const auto parameters_data =
         std::string { std::istreambuf_iterator<char> { parameters_input_file },
                       std::istreambuf_iterator<char> {} };
 
-      const auto parameters = simulator::Parameters::from_json(parameters_data);
+      // a resumed simulation completes the results of the interrupted one,
+      // with the seed of its checkpoint unless one is given
+      const auto checkpoint_path =
+        fs::path { output_path } / simulation_path.filename() /
+        "checkpoint.bin";
+      const auto resumed = resume && fs::exists(checkpoint_path);
+      const auto parameters = simulator::Parameters::from_json(
+        parameters_data,
+        resumed && !seed.has_value()
+          ? std::optional(
+              simulator::Checkpoint::load_header(checkpoint_path).seed)
+          : seed);
+
+      // each rank owns a range of the nodes, rank 0 writes the counts
+      if (ranks > 1 || mpi) {
+        if (parameters.runs > 1 || format == "binary") {
+          throw std::invalid_argument("a distributed simulation only records "
+                                      "the counts of a single run in json");
+        }
+        if (checkpoint_every != 0 || resume) {
+          throw std::invalid_argument(
+            "a distributed simulation has no checkpoint");
+        }
+        if (execution.fused || execution.aggregated ||
+            execution.sort_interval != 0 || execution.numa) {
+          throw std::invalid_argument("a distributed simulation has no "
+                                      "--fused, --aggregated, --sort-every "
+                                      "or --numa");
+        }
+
+        const auto simulate =
+          [&](std::shared_ptr<simulator::distributed::Communicator>
+                communicator) {
+            // rank 0 writes the cache of the environment, the other ranks
+            // map it once it is written
+            if (communicator->rank() != 0) {
+              communicator->barrier();
+            }
+            auto environment = std::make_shared<simulator::Environment>(
+              simulator::Environment::load(simulation_path).reorder(ordering));
+            if (communicator->rank() == 0) {
+              communicator->barrier();
+            }
+
+            // the ranks only keep the edges of their nodes
+            auto simulation = simulator::distributed::Simulation(
+              std::move(environment),
+              std::make_shared<simulator::Parameters>(parameters),
+              communicator);
+            simulation.run();
+            if (communicator->rank() != 0) {
+              return;
+            }
+
+            nlohmann::json json_results = simulation.get_states();
+            auto output_path_simulation =
+              output_path / simulation_path.filename() / "results.json";
+            fs::create_directories(output_path_simulation.parent_path());
+            std::ofstream output_file(output_path_simulation);
+            output_file << json_results.dump(2);
+          };
+
+#ifdef SIMULATOR_MPI
+        if (mpi) {
+          simulate(
+            std::make_shared<simulator::distributed::MpiCommunicator>());
+          continue;
+        }
+#endif
+        simulator::distributed::SharedMemoryCommunicator::run(
+          ranks, simulator::distributed::Simulation::capacity(parameters),
+          simulate);
+        continue;
+      }
 
       const auto environment =
-        simulator::Environment::from_geojson(environment_data);
+        simulator::Environment::load(simulation_path).reorder(ordering);
+
+      // replicas are written to one output directory each, e.g. `name/0`
+      if (parameters.runs > 1) {
+        if (checkpoint_every != 0 || resume) {
+          throw std::invalid_argument("only a single run has a checkpoint");
+        }
+        if (output_mode == "history") {
+          throw std::invalid_argument("only a single run records a history");
+        }
+
+        const auto replica_path = [&](std::size_t replica) {
+          return fs::path { output_path } / simulation_path.filename() /
+            std::to_string(replica);
+        };
+        const auto make_sink =
+          [&](std::size_t replica, const simulator::Parameters& parameters)
+          -> std::shared_ptr<simulator::output::Sink> {
+          if (format == "binary") {
+            return pipelined(simulator::output::renumbered(
+              simulator::output::make_results_writer(
+                replica_path(replica) / "results.bin", output_mode, every,
+                parameters),
+              environment));
+          }
+          return pipelined(simulator::output::renumbered(
+            simulator::output::make_sink(output_mode, every, cohort,
+                                         parameters),
+            environment));
+        };
+
+        const auto monte_carlo = simulator::MonteCarlo(
+          std::make_shared<simulator::Environment>(environment),
+          parameters_data, parameters.seed, jobs, make_sink, execution);
+        // each replica is written once done, so only the running ones are
+        // held in memory
+        monte_carlo.run([&](std::size_t replica, const simulator::Parameters&,
+                            const std::vector<simulator::State>& states) {
+          if (format == "binary") {
+            return;
+          }
+
+          nlohmann::json json_results = states;
+          fs::create_directories(replica_path(replica));
+          std::ofstream output_file(replica_path(replica) / "results.json");
+          output_file << json_results.dump(2);
+        });
+        continue;
+      }
+
+      // the binary results are streamed to disk while the simulation runs
+      const auto recorder = format == "binary"
+        ? std::shared_ptr<simulator::output::Sink>(
+            simulator::output::make_results_writer(
+              fs::path { output_path } / simulation_path.filename() /
+                "results.bin",
+              output_mode, every, parameters, resumed))
+        : simulator::output::make_sink(output_mode, every, cohort, parameters);
+      // the history is kept by its sink and written once the run is over
+      const auto history =
+        std::dynamic_pointer_cast<simulator::output::HistorySink>(recorder);
+      const auto sink =
+        pipelined(simulator::output::renumbered(recorder, environment));
 
           auto simulation = simulator::Simulation(
             std::make_shared<simulator::Environment>(environment),
-            std::make_shared<simulator::Parameters>(parameters));
-
+            std::make_shared<simulator::Parameters>(parameters),
+            std::thread::hardware_concurrency(), sink, 1, execution);
 
+          simulation.checkpoint(checkpoint_path, checkpoint_every);
+          if (resumed) {
+            simulation.resume(checkpoint_path);
+          }
           simulation.run();
 
+          if (format == "binary") {
+            continue;
+          }
+
           // get the simulation results and save them
           const auto& results = simulation.get_states();
           nlohmann::json json_results = results;
@@ -74,9 +388,28 @@ auto main(int argc, char* argv[]) -> int {
           output_file << json_results.dump(2);
           output_file.close();
 
+          if (history) {
+            std::ofstream(output_path / simulation_path.filename() /
+                          "history.json")
+              << history->to_json().dump();
+          }
+
     }
+
+#ifdef SIMULATOR_MPI
+    if (mpi) {
+      MPI_Finalize();
+    }
+#endif
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
+#ifdef SIMULATOR_MPI
+    auto initialized = 0;
+    MPI_Initialized(&initialized);
+    if (initialized != 0) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+#endif
     std::exit(EXIT_FAILURE);
   }
 }
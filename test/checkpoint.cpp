@@ -0,0 +1,80 @@
+#include "test.hpp"
+
+#include <simulator/checkpoint.hpp>
+#include <simulator/environment.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/parameters.hpp>
+#include <simulator/simulation.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+  auto simulation(std::uint64_t seed) -> simulator::Simulation {
+    return { std::make_shared<simulator::Environment>(
+               simulator::Environment::from_geojson(test::grid(12, 10))),
+             std::make_shared<simulator::Parameters>(test::parameters(seed)),
+             2, std::make_shared<simulator::output::SnapshotSink>(1) };
+  }
+
+  auto read(const std::filesystem::path& path) -> std::string {
+    auto file = std::ifstream(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(file),
+             std::istreambuf_iterator<char>() };
+  }
+
+  const auto round_trip = test::Case("checkpoint: round trip", [] {
+    const auto directory = test::directory("checkpoint");
+    auto fresh = simulation(42);
+    fresh.checkpoint(directory / "checkpoint.bin", 7);
+    fresh.run();
+    const auto& expected = fresh.get_states();
+
+    const auto checkpoint =
+      simulator::Checkpoint::load(directory / "checkpoint.bin");
+    test::check(checkpoint.header.iteration == 28 &&
+                  checkpoint.header.seed == 42 &&
+                  checkpoint.header.replicas == 1,
+                "the last checkpoint is the one of cycle 28");
+    test::check(checkpoint.states.size() == 1 &&
+                  checkpoint.states[0].size() == 28 &&
+                  checkpoint.states[0].back().humans[0] ==
+                    std::get<0>(expected[27].humans_in_states),
+                "the counts of the cycles so far are saved");
+
+    checkpoint.save(directory / "saved.bin");
+    test::check(read(directory / "checkpoint.bin") ==
+                  read(directory / "saved.bin"),
+                "a loaded checkpoint is saved back as it was");
+  });
+
+  const auto resume = test::Case("checkpoint: resume", [] {
+    const auto directory = test::directory("resume");
+    auto fresh = simulation(42);
+    fresh.checkpoint(directory / "checkpoint.bin", 7);
+    fresh.run();
+
+    auto resumed = simulation(42);
+    resumed.resume(directory / "checkpoint.bin");
+    resumed.run();
+    test::check(test::same(fresh.get_states(), resumed.get_states(), 29),
+                "a resumed run continues as the uninterrupted one");
+
+    auto other = simulation(43);
+    auto thrown = false;
+    try {
+      other.resume(directory / "checkpoint.bin");
+    } catch (const std::exception&) {
+      thrown = true;
+    }
+    test::check(thrown, "a checkpoint of another seed is not resumed");
+  });
+} // namespace
@@ -0,0 +1,91 @@
+#include "test.hpp"
+
+#include <simulator/environment.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+
+namespace {
+  auto equal(const simulator::Environment& expected,
+             const simulator::Environment& actual) -> bool {
+    return expected.size == actual.size && expected.hash == actual.hash &&
+      std::ranges::equal(expected.points, actual.points) &&
+      std::ranges::equal(expected.offsets, actual.offsets) &&
+      std::ranges::equal(expected.neighbours, actual.neighbours);
+  }
+
+  auto write(const std::filesystem::path& path, const std::string& data)
+    -> void {
+    auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    file << data;
+  }
+
+  const auto round_trip = test::Case("environment: round trip", [] {
+    const auto directory = test::directory("environment");
+    const auto source = directory / "environment.json";
+    const auto data = test::grid(12, 10);
+    write(source, data);
+
+    const auto expected = simulator::Environment::from_geojson(data);
+    expected.to_binary(directory / "environment.bin", source);
+    test::check(equal(expected, simulator::Environment::from_binary(
+                                  directory / "environment.bin")),
+                "the compiled environment is mapped back");
+  });
+
+  const auto cache = test::Case("environment: cache", [] {
+    const auto directory = test::directory("cache");
+    const auto source = directory / "environment.json";
+    const auto cache = directory / "environment.bin";
+    write(source, test::grid(12, 10));
+
+    const auto expected = simulator::Environment::from_geojson(
+      test::grid(12, 10));
+    test::check(equal(expected, simulator::Environment::load(directory)),
+                "the source is parsed");
+    test::check(std::filesystem::exists(cache), "the cache is written");
+    test::check(equal(expected, simulator::Environment::load(directory)),
+                "the cache is loaded");
+
+    write(source, test::grid(5, 4));
+    test::check(equal(simulator::Environment::from_geojson(test::grid(5, 4)),
+                      simulator::Environment::load(directory)),
+                "a stale cache is rebuilt");
+  });
+
+  const auto corrupt = test::Case("environment: corrupt cache", [] {
+    const auto directory = test::directory("corrupt");
+    const auto source = directory / "environment.json";
+    const auto cache = directory / "environment.bin";
+    const auto expected = simulator::Environment::from_geojson(
+      test::grid(12, 10));
+    write(source, test::grid(12, 10));
+
+    // a cache cut short, then one whose offsets decrease, the header of both
+    // still matching the source
+    expected.to_binary(cache, source);
+    std::filesystem::resize_file(cache, std::filesystem::file_size(cache) / 2);
+    test::check(equal(expected, simulator::Environment::load(directory)),
+                "a truncated cache is rebuilt");
+
+    expected.to_binary(cache, source);
+    {
+      auto file = std::fstream(cache, std::ios::binary | std::ios::in |
+                                        std::ios::out);
+      // the offsets follow the 64 bytes of the header and the points
+      const auto last = std::numeric_limits<std::uint32_t>::max();
+      file.seekp(static_cast<std::streamoff>(
+        64 + expected.size * sizeof(simulator::Environment::Point) +
+        sizeof(std::uint32_t)));
+      file.write(reinterpret_cast<const char*>(&last), sizeof(last));
+    }
+    test::check(equal(expected, simulator::Environment::load(directory)),
+                "a cache with corrupt offsets is rebuilt");
+    test::check(equal(expected, simulator::Environment::from_binary(cache)),
+                "the rebuilt cache is mapped");
+  });
+} // namespace
@@ -0,0 +1,69 @@
+#include "test.hpp"
+
+#include <simulator/environment.hpp>
+#include <simulator/human.hpp>
+#include <simulator/mosquito.hpp>
+#include <simulator/output/history.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/parameters.hpp>
+#include <simulator/simulation.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace {
+  auto run(std::shared_ptr<simulator::output::Sink> sink)
+    -> std::vector<simulator::State> {
+    auto simulation = simulator::Simulation(
+      std::make_shared<simulator::Environment>(
+        simulator::Environment::from_geojson(test::grid(12, 10))),
+      std::make_shared<simulator::Parameters>(test::parameters(42)), 2,
+      sink);
+    simulation.run();
+    return simulation.get_states();
+  }
+
+  /**
+   * @brief Whether the reconstructed agents have the states, and when
+   * `positions` the positions, of the recorded ones
+   */
+  template <typename Agent>
+  auto matches(const std::vector<Agent>& expected,
+               const std::vector<Agent>& actual, bool positions) -> bool {
+    if (expected.size() != actual.size()) {
+      return false;
+    }
+    for (std::size_t id = 0; id < expected.size(); id++) {
+      if (expected[id].id != actual[id].id ||
+          expected[id].state != actual[id].state ||
+          (positions && expected[id].position != actual[id].position)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const auto reconstruction = test::Case("history: reconstruction", [] {
+    const auto expected =
+      run(std::make_shared<simulator::output::SnapshotSink>(1));
+
+    for (const auto positions : { true, false }) {
+      const auto history =
+        std::make_shared<simulator::output::HistorySink>(4, positions);
+      run(history);
+
+      test::check(history->cycles() == expected.size(),
+                  "every cycle is recorded");
+      for (std::size_t cycle = 1; cycle <= expected.size(); cycle++) {
+        test::check(matches(expected[cycle - 1].humans,
+                            history->humans_at(cycle), positions),
+                    "the humans of a cycle are reconstructed");
+        test::check(matches(expected[cycle - 1].mosquitos,
+                            history->mosquitos_at(cycle), positions),
+                    "the mosquitos of a cycle are reconstructed");
+      }
+    }
+  });
+} // namespace
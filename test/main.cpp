@@ -0,0 +1,156 @@
+#include "test.hpp"
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace test {
+  using json = nlohmann::json;
+
+  namespace {
+    struct Failure : std::runtime_error {
+      using std::runtime_error::runtime_error;
+    };
+  } // namespace
+
+  Case::Case(std::string_view name, auto (*body)() -> void)
+    : name(name), body(body) {
+    cases().push_back(this);
+  }
+
+  auto cases() -> std::vector<const Case*>& {
+    static auto cases = std::vector<const Case*>();
+    return cases;
+  }
+
+  auto check(bool condition, std::string_view what,
+             std::source_location location) -> void {
+    if (!condition) {
+      throw Failure(std::string(location.file_name()) + ":" +
+                    std::to_string(location.line()) + ": " +
+                    std::string(what));
+    }
+  }
+
+  auto directory(std::string_view name) -> std::filesystem::path {
+    const auto directory = std::filesystem::temp_directory_path() /
+      ("simulator-test-" + std::string(name));
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+  }
+
+  auto grid(std::size_t width, std::size_t height) -> std::string {
+    auto features = json::array();
+    // NOTE: Points ids begin at 1, as in the environments of the inputs
+    const auto id = [width](std::size_t x, std::size_t y) {
+      return y * width + x + 1;
+    };
+    for (std::size_t y = 0; y < height; y++) {
+      for (std::size_t x = 0; x < width; x++) {
+        features.push_back(json {
+          { "type", "Feature" },
+          { "id", id(x, y) },
+          { "geometry",
+            { { "type", "Point" },
+              { "coordinates", { static_cast<double>(x),
+                                 static_cast<double>(y) } } } },
+        });
+      }
+    }
+    const auto edge = [&features](std::size_t src, std::size_t tgt) {
+      features.push_back(json {
+        { "type", "Feature" },
+        { "src", src },
+        { "tgt", tgt },
+        { "geometry", { { "type", "LineString" } } },
+      });
+    };
+    for (std::size_t y = 0; y < height; y++) {
+      for (std::size_t x = 0; x < width; x++) {
+        if (x + 1 < width) {
+          edge(id(x, y), id(x + 1, y));
+        }
+        if (y + 1 < height) {
+          edge(id(x, y), id(x, y + 1));
+        }
+      }
+    }
+    return json { { "type", "FeatureCollection" }, { "features", features } }
+      .dump();
+  }
+
+  auto parameters(std::uint64_t seed, std::size_t cycles)
+    -> simulator::Parameters {
+    return {
+      .runs = 1,
+      .cycles = cycles,
+      .human_infection_rate = 0.3,
+      .human_initial_susceptible = 400,
+      .human_initial_exposed = 0,
+      .human_initial_infected = 40,
+      .human_initial_recovered = 0,
+      .human_transition_period_exposed = 3,
+      .human_transition_period_infected = 5,
+      .human_transition_period_recovered = 10,
+      .mosquito_infection_rate = 0.3,
+      .mosquito_initial_susceptible = 800,
+      .mosquito_initial_infected = 40,
+      .mosquito_initial_recovered = 0,
+      .mosquito_transition_period_infected = 10,
+      .mosquito_transition_period_recovered = 5,
+      .seed = seed,
+    };
+  }
+
+  auto same(const std::vector<simulator::State>& expected,
+            const std::vector<simulator::State>& actual, std::size_t agents)
+    -> bool {
+    if (expected.size() != actual.size()) {
+      return false;
+    }
+    for (std::size_t cycle = 1; cycle <= expected.size(); cycle++) {
+      auto left = expected[cycle - 1];
+      auto right = actual[cycle - 1];
+      if (cycle < agents) {
+        left.humans.clear();
+        left.mosquitos.clear();
+        right.humans.clear();
+        right.mosquitos.clear();
+      }
+      if (json(left) != json(right)) {
+        return false;
+      }
+    }
+    return true;
+  }
+} // namespace test
+
+auto main(int argc, char* argv[]) -> int {
+  // the cases whose name starts with the argument, all of them without one
+  const auto filter = std::string_view(argc > 1 ? argv[1] : "");
+
+  auto failures = 0UL;
+  for (const auto* test : test::cases()) {
+    if (!test->name.starts_with(filter)) {
+      continue;
+    }
+    try {
+      test->body();
+      std::cout << "ok      " << test->name << std::endl;
+    } catch (const std::exception& e) {
+      failures++;
+      std::cout << "FAILED  " << test->name << "\n        " << e.what()
+                << std::endl;
+    }
+  }
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,73 @@
+#include "test.hpp"
+
+#include <simulator/environment.hpp>
+#include <simulator/output/results.hpp>
+#include <simulator/output/sink.hpp>
+#include <simulator/parameters.hpp>
+#include <simulator/simulation.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace {
+  auto run(const simulator::Parameters& parameters,
+           std::shared_ptr<simulator::output::Sink> sink)
+    -> std::vector<simulator::State> {
+    auto simulation = simulator::Simulation(
+      std::make_shared<simulator::Environment>(
+        simulator::Environment::from_geojson(test::grid(12, 10))),
+      std::make_shared<simulator::Parameters>(parameters), 2, sink);
+    simulation.run();
+    return simulation.get_states();
+  }
+
+  const auto round_trip = test::Case("results: round trip", [] {
+    const auto path = test::directory("results") / "results.bin";
+    const auto parameters = test::parameters(42);
+    auto expected =
+      run(parameters, std::make_shared<simulator::output::SnapshotSink>(5));
+    run(parameters, std::make_shared<simulator::output::ResultsWriter>(
+                      path, parameters, 5));
+
+    const auto reader = simulator::output::ResultsReader(path);
+    test::check(reader.header().seed == parameters.seed &&
+                  reader.header().cycles == parameters.cycles &&
+                  reader.header().recorded == parameters.cycles &&
+                  reader.header().every == 5,
+                "the header describes the run");
+
+    // the counters of the agents are not recorded
+    for (auto& state : expected) {
+      for (auto& human : state.humans) {
+        human.counter = 0;
+      }
+      for (auto& mosquito : state.mosquitos) {
+        mosquito.counter = 0;
+      }
+    }
+    test::check(test::same(expected, reader.states()),
+                "the agents are read back every 5 cycles");
+    test::check(test::same(expected, reader.states(false),
+                           parameters.cycles + 1),
+                "the counts are read back without the agents");
+  });
+
+  const auto truncated = test::Case("results: truncated file", [] {
+    const auto path = test::directory("truncated") / "results.bin";
+    const auto parameters = test::parameters(42);
+    run(parameters, std::make_shared<simulator::output::ResultsWriter>(
+                      path, parameters, 5));
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+    auto thrown = false;
+    try {
+      const auto reader = simulator::output::ResultsReader(path);
+    } catch (const std::exception&) {
+      thrown = true;
+    }
+    test::check(thrown, "a truncated file is not read");
+  });
+} // namespace
@@ -0,0 +1,68 @@
+#include "test.hpp"
+
+#include <simulator/environment.hpp>
+#include <simulator/parameters.hpp>
+#include <simulator/simulation.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+  auto run(std::uint64_t seed, std::size_t threads)
+    -> std::vector<simulator::State> {
+    auto simulation = simulator::Simulation(
+      std::make_shared<simulator::Environment>(
+        simulator::Environment::from_geojson(test::grid(12, 10))),
+      std::make_shared<simulator::Parameters>(test::parameters(seed)),
+      threads);
+    simulation.run();
+    return simulation.get_states();
+  }
+
+  const auto parameters = test::Case("seed: sampled parameters", [] {
+    const auto* const ranges = R"({
+      "runs": 1, "cycles": 10,
+      "human_infection_rate": [0.1, 0.9],
+      "human_initial_susceptible": [100, 200],
+      "human_initial_exposed": [0, 10],
+      "human_initial_infected": [1, 10],
+      "human_initial_recovered": [0, 10],
+      "human_transition_period_exposed": [1, 5],
+      "human_transition_period_infected": [1, 5],
+      "human_transition_period_recovered": [1, 5],
+      "mosquito_infection_rate": [0.1, 0.9],
+      "mosquito_initial_susceptible": [100, 200],
+      "mosquito_initial_infected": [1, 10],
+      "mosquito_initial_recovered": [0, 10],
+      "mosquito_transition_period_infected": [1, 5],
+      "mosquito_transition_period_recovered": [1, 5],
+      "seed": 7
+    })";
+
+    const auto first = simulator::Parameters::from_json(ranges);
+    const auto second = simulator::Parameters::from_json(ranges);
+    test::check(first.seed == 7, "the seed of the json is used");
+    test::check(first.human_infection_rate == second.human_infection_rate &&
+                  first.human_initial_susceptible ==
+                    second.human_initial_susceptible &&
+                  first.mosquito_initial_susceptible ==
+                    second.mosquito_initial_susceptible,
+                "the same seed samples the same parameters");
+
+    const auto given = simulator::Parameters::from_json(ranges, 8);
+    test::check(given.seed == 8, "the given seed replaces the one of the json");
+  });
+
+  const auto threads = test::Case("seed: any thread count", [] {
+    const auto expected = run(42, 1);
+    test::check(test::same(expected, run(42, 1)),
+                "a run is repeated with the same seed");
+    test::check(test::same(expected, run(42, 4)),
+                "the thread count does not change the results");
+    test::check(!test::same(expected, run(43, 4)),
+                "another seed gives other results");
+  });
+} // namespace
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <simulator/parameters.hpp>
+#include <simulator/state.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace test {
+  /**
+   * @brief A test case, registered at static initialization by a `Case`
+   * object and run by the `test` target
+   */
+  struct Case {
+    std::string_view name;
+    auto (*body)() -> void;
+
+    Case(std::string_view name, auto (*body)() -> void);
+  };
+
+  [[nodiscard]] auto cases() -> std::vector<const Case*>&;
+
+  /**
+   * @brief Fail the running case when `condition` does not hold
+   */
+  auto check(bool condition, std::string_view what,
+             std::source_location location =
+               std::source_location::current()) -> void;
+
+  /**
+   * @brief An empty directory for the files of a case, under the temporary
+   * directory of the system
+   */
+  [[nodiscard]] auto directory(std::string_view name) -> std::filesystem::path;
+
+  /**
+   * @brief GeoJSON of a `width` by `height` grid, each node linked to the
+   * nodes around it
+   */
+  [[nodiscard]] auto grid(std::size_t width, std::size_t height)
+    -> std::string;
+
+  /**
+   * @brief Parameters of a small epidemic, `cycles` long
+   */
+  [[nodiscard]] auto parameters(std::uint64_t seed, std::size_t cycles = 30)
+    -> simulator::Parameters;
+
+  /**
+   * @brief Whether the states are the same, the agents are only compared in
+   * the cycles from `agents` on
+   */
+  [[nodiscard]] auto same(const std::vector<simulator::State>& expected,
+                          const std::vector<simulator::State>& actual,
+                          std::size_t agents = 1) -> bool;
+} // namespace test
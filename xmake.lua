@@ -5,105 +5,98 @@ set_languages("c++latest")
 
 
 --[[ Project settings ]]
-set_toolchains("cuda", "gcc")
+option("host", function()
+  set_default(false)
+  set_showmenu(true)
+  set_description("Host only backend, plain GCC/Clang without NVHPC and the gpu")
+  add_defines("SIMULATOR_HOST_ONLY")
+end)
+
+option("mpi", function()
+  set_default(false)
+  set_showmenu(true)
+  set_description("MPI ranks for the distributed simulation, see --mpi")
+  add_defines("SIMULATOR_MPI")
+end)
+
 add_rules("mode.debug", "mode.release", "mode.releasedbg", "plugin.compile_commands.autoupdate")
 set_defaultmode("release")
 -- set_warnings("all", "error", "allextra")
 set_optimize("fastest")
 add_includedirs("include")
-add_cxxflags("-std=c++23", "-stdpar=gpu", { force = true })
-add_ldflags("-stdpar=gpu", { force = true })
-add_defines("_NVHPC_CUDA", "__NVCOMPILER_CUDA_ARCH__=600", "__pgnu_vsn=130000") -- sm60 is pascal arch
 
 set_policy("build.optimization.lto", true)
 set_policy("build.ccache", true)
 -- set_policy("build.warning", false)
 
-add_requires("cmake::NVHPC",
-  {
-    system = true,
-    configs = {
-      envs = {
-        CMAKE_PREFIX_PATH = "/opt/nvidia/hpc_sdk/Linux_x86_64/25.3/cmake/",
-        CMAKE_CXX_FLAGS = "-std=c++23 -stdpar --experimental-stdpar"
-      },
-      components = {
-        "CUDA",
-        "MATH",
-        "HOSTUTILS",
-        "NVSHMEM",
-        "NCCL",
-        -- "MPI",
-        "PROFILER"
-      },
-      link_libraries = {
-        "NVHPC::CUDA",
-        "NVHPC::MATH",
-        "NVHPC::HOSTUTILS",
-        "NVHPC::NVSHMEM",
-        "NVHPC::NCCL",
-        -- "NVHPC::MPI",
-        "NVHPC::PROFILER"
+if has_config("host") then
+  -- the parallel algorithms of libstdc++ run on TBB
+  add_requires("tbb")
+  add_packages("tbb")
+else
+  set_toolchains("cuda", "gcc")
+  add_cxxflags("-std=c++23", "-stdpar=gpu", { force = true })
+  add_ldflags("-stdpar=gpu", { force = true })
+  add_defines("_NVHPC_CUDA", "__NVCOMPILER_CUDA_ARCH__=600", "__pgnu_vsn=130000") -- sm60 is pascal arch
+
+  add_requires("cmake::NVHPC",
+    {
+      system = true,
+      configs = {
+        envs = {
+          CMAKE_PREFIX_PATH = "/opt/nvidia/hpc_sdk/Linux_x86_64/25.3/cmake/",
+          CMAKE_CXX_FLAGS = "-std=c++23 -stdpar --experimental-stdpar"
+        },
+        components = {
+          "CUDA",
+          "MATH",
+          "HOSTUTILS",
+          "NVSHMEM",
+          "NCCL",
+          -- "MPI",
+          "PROFILER"
+        },
+        link_libraries = {
+          "NVHPC::CUDA",
+          "NVHPC::MATH",
+          "NVHPC::HOSTUTILS",
+          "NVHPC::NVSHMEM",
+          "NVHPC::NCCL",
+          -- "NVHPC::MPI",
+          "NVHPC::PROFILER"
+        }
       }
     }
-  }
-)
-add_packages("cmake::NVHPC")
+  )
+  add_packages("cmake::NVHPC")
+end
+
 
+if has_config("mpi") then
+  add_requires("openmpi")
+  add_packages("openmpi")
+end
 
 -- [[ Project dependencies and repositories ]]
 local simulator_deps = { "nlohmann_json", "stdexec" }
 local simula_cli_deps = { "nlohmann_json", "stdexec", "argparse", "indicators" };
 local bench_deps = { "nlohmann_json", "stdexec", "argparse" }
+local results_cli_deps = { "nlohmann_json", "argparse" }
+local test_deps = { "nlohmann_json", "stdexec" }
 
 add_requires(table.unpack(simulator_deps))
 add_requires(table.unpack(simula_cli_deps))
--- add_requires(table.unpack(test_deps))
+add_requires(table.unpack(test_deps))
 add_requires(table.unpack(bench_deps))
 
 
 -- [[ options ]]
-option("sync", function()
-  set_default(false)
-  set_showmenu(true)
-  set_description("Enable synchronous execution")
-  add_defines("SYNC")
-end)
-
 option("gpus", function()
   set_default("0,1")
   set_showmenu(true)
   set_description("CUDA_VISIBLE_DEVICES")
 end)
 
-option("insertion_cpu", function()
-  set_default(false)
-  set_showmenu(true)
-  set_description("Insertion on CPU")
-  add_defines("INSERTION_CPU")
-end)
-
-option("movement_cpu", function()
-  set_default(false)
-  set_showmenu(true)
-  set_description("Movement on CPU")
-  add_defines("MOVEMENT_CPU")
-end)
-
-option("contact_cpu", function()
-  set_default(false)
-  set_showmenu(true)
-  set_description("Contact on CPU")
-  add_defines("CONTACT_CPU")
-end)
-
-option("transition_cpu", function()
-  set_default(false)
-  set_showmenu(true)
-  set_description("Transition on CPU")
-  add_defines("TRANSITION_CPU")
-end)
-
 -- [[ Project targets ]]
 target("simulator", function()
   set_default(true)
@@ -112,7 +105,7 @@ target("simulator", function()
   add_packages(table.unpack(simulator_deps))
   set_targetdir("./simulator")
   set_installdir("./simulator")
-  add_options("sync", "gpus", "insertion_cpu", "movement_cpu", "contact_cpu", "transition_cpu")
+  add_options("host", "mpi", "gpus")
   add_runenvs("CUDA_VISIBLE_DEVICES", "$(gpus)")
 end)
 
@@ -125,7 +118,7 @@ target("simula_cli", function()
   add_deps("simulator")
   set_targetdir("./simulator")
   set_installdir("./simulator")
-  add_options("sync", "gpus", "insertion_cpu", "movement_cpu", "contact_cpu", "transition_cpu")
+  add_options("host", "gpus")
   add_runenvs("CUDA_VISIBLE_DEVICES", "$(gpus)")
 end)
 
@@ -137,10 +130,20 @@ target("simulator_cli", function()
   add_deps("simulator")
   set_targetdir("./simulator")
   set_installdir("./simulator")
-  add_options("sync", "gpus", "insertion_cpu", "movement_cpu", "contact_cpu", "transition_cpu")
+  add_options("host", "mpi", "gpus")
   add_runenvs("CUDA_VISIBLE_DEVICES", "$(gpus)")
 end)
 
+target("results_cli", function()
+  set_default(true)
+  set_kind("binary")
+  add_files("src/results_cli/*.cpp")
+  add_packages(table.unpack(results_cli_deps))
+  add_deps("simulator")
+  set_targetdir("./simulator")
+  set_installdir("./simulator")
+end)
+
 target("bench", function()
   set_default(true)
   set_kind("binary")
@@ -149,6 +152,18 @@ target("bench", function()
   add_deps("simulator")
   set_targetdir("./simulator")
   set_installdir("./simulator")
-  add_options("sync", "gpus", "insertion_cpu", "movement_cpu", "contact_cpu", "transition_cpu")
+  add_options("host", "gpus")
+  add_runenvs("CUDA_VISIBLE_DEVICES", "$(gpus)")
+end)
+
+target("test", function()
+  set_default(false)
+  set_kind("binary")
+  add_files("test/*.cpp")
+  add_packages(table.unpack(test_deps))
+  add_deps("simulator")
+  set_targetdir("./simulator")
+  set_installdir("./simulator")
+  add_options("host", "gpus")
   add_runenvs("CUDA_VISIBLE_DEVICES", "$(gpus)")
 end)